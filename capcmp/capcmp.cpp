@@ -0,0 +1,152 @@
+///////////////////////////////////////////////////////////////////////
+// capcmp.cpp -- Compare a raw capture against a golden capture
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#include "rawcap.hpp"
+#include "capcmp.hpp"
+
+static void
+usage(const char *cmd) {
+    const char *cp = strrchr(cmd,'/');
+    
+    if ( cp )
+        cmd = cp+1; // Report basename of command
+
+    fprintf(stderr,
+	"Usage: %s [-T | -c gpio [-l lag]] [-t tol] [-m mask] [-v] golden.raw test.raw\n"
+        "where:\n"
+	"\t-T\t\tAlign the captures by their triggers\n"
+	"\t-c gpio\t\tAlign by cross-correlating this gpio\n"
+	"\t-l lag\t\tLargest lag searched by -c, in samples (100000)\n"
+	"\t-t tol\t\tIgnore differences of tol samples or less (0)\n"
+	"\t-m mask\t\tCompare only these gpios (0xFFFFFFFF)\n"
+	"\t-v\t\tVerbose\n"
+        "\t-h\t\tThis info.\n\n"
+        "\tCompares captures written by pispy -W. Without -T or -c,\n"
+        "\tthe triggers are used when both captures have one, else the\n"
+        "\tfirst samples are lined up. Exits 0 when the captures match,\n"
+        "\t1 when mismatches are reported.\n",
+        cmd);
+}
+
+static void
+load(RawCapture& cap,const char *path) {
+    int er = cap.load(path);
+
+    if ( er ) {
+        fprintf(stderr,"%s: reading %s\n",strerror(er),path);
+        exit(3);
+    }
+}
+
+static double
+elapsed_ms(const struct timespec& t0) {
+    struct timespec t1;
+
+    clock_gettime(CLOCK_MONOTONIC,&t1);
+    return ( t1.tv_sec - t0.tv_sec ) * 1e3 + ( t1.tv_nsec - t0.tv_nsec ) / 1e6;
+}
+
+int
+main(int argc,char **argv) {
+    static const char options[] = "Tc:l:t:m:vh";
+    bool opt_T = false, opt_verbose = false;
+    int opt_c = -1;
+    unsigned long long opt_l = 100000;
+    unsigned opt_t = 0;
+    uint32_t opt_m = ~0u;
+    bool opt_errs = false;
+    int optch;
+
+    while ( (optch = getopt(argc,argv,options)) != -1 ) {
+        switch ( optch ) {
+        case 'T':
+            opt_T = true;
+            break;
+        case 'c':
+            opt_c = atoi(optarg);
+            if ( opt_c < 0 || opt_c >= CAPCMP_CHANNELS ) {
+                fprintf(stderr,"Invalid gpio: -c %s\n",optarg);
+                opt_errs = true;
+            }
+            break;
+        case 'l':
+            opt_l = strtoull(optarg,0,0);
+            break;
+        case 't':
+            opt_t = unsigned(strtoul(optarg,0,0));
+            break;
+        case 'm':
+            opt_m = uint32_t(strtoul(optarg,0,0));
+            break;
+        case 'v':
+            opt_verbose = true;
+            break;
+        case 'h':
+            usage(argv[0]);
+            exit(0);
+        default:
+            opt_errs = true;
+        }
+    }
+
+    if ( opt_T && opt_c >= 0 ) {
+        fprintf(stderr,"Options -T and -c are mutually exclusive.\n");
+        opt_errs = true;
+    }
+
+    if ( opt_errs || argc - optind != 2 ) {
+        usage(argv[0]);
+        exit(2);
+    }
+
+    RawCapture golden, test;
+    CaptureCompare cmp;
+    struct timespec t0;
+    int64_t lag = 0;
+
+    load(golden,argv[optind]);
+    load(test,argv[optind+1]);
+
+    clock_gettime(CLOCK_MONOTONIC,&t0);
+
+    if ( opt_c >= 0 ) {
+        if ( !CaptureCompare::correlate(golden.data(),golden.get_samples(),
+          test.data(),test.get_samples(),unsigned(opt_c),opt_l,lag) ) {
+            fprintf(stderr,"Unable to correlate gpio%d (no matching edges).\n",opt_c);
+            exit(4);
+        }
+        if ( opt_verbose )
+            printf("Correlated gpio%d: lag %lld samples.\n",opt_c,(long long)lag);
+    } else if ( golden.triggered() && test.triggered() ) {
+        lag = CaptureCompare::align_trigger(golden.get_trigger(),test.get_trigger());
+        if ( opt_verbose )
+            printf("Aligned triggers: lag %lld samples.\n",(long long)lag);
+    } else if ( opt_T ) {
+        fprintf(stderr,"Both captures must be triggered for -T.\n");
+        exit(4);
+    }
+
+    cmp.set_mask(opt_m);
+    cmp.set_tolerance(opt_t);
+    cmp.compare(golden.data(),golden.get_samples(),test.data(),test.get_samples(),lag);
+
+    if ( opt_verbose )
+        printf("Compared in %.3f ms.\n",elapsed_ms(t0));
+
+    cmp.write(stdout,golden.get_period());
+    return cmp.get_windows().empty() ? 0 : 1;
+}
+
+// End capcmp.cpp
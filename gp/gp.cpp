@@ -18,8 +18,10 @@
 #include <assert.h>
 
 #include "gpio.hpp"
+#include "gpioevt.hpp"
 
 #include <string>
+#include <vector>
 
 static GPIO gpio;
 
@@ -44,7 +46,7 @@ usage(const char *cmd) {
 	"\t-w\t\tRead all 32 gpio bits (-g ignored)\n"
 	"\t-A\t\tRead alternate function setting for gpio\n"
 	"\t-b n\t\tBlink gpio value for n times (0=forever)\n"
-	"\t-m n\t\tMonitor gpio for changes (n seconds)\n"
+	"\t-m n\t\tMonitor gpio for changes (n seconds, 0=forever)\n"
 	"\t-D\t\tDisplay all gpio configuration\n"
         "\t-C\t\tDisplay a chart of GPIO vs Alt functions\n"
 	"\t-R n\t\tSet gpio pad slew rate limit on (1) or off (0)\n"
@@ -69,7 +71,7 @@ display_all() {
     putchar('\n');
     printf("GPIO ALTFUN LEV SLEW HYST DRIVE DESCRIPTION\n");
     printf("---- ------ --- ---- ---- ----- -----------\n");
-    for (int gpno=0; gpno < 32; ++gpno ) {
+    for (int gpno=0; gpno <= GPIO_MAX; ++gpno ) {
         gpio.alt_function(gpno,io);
         gpio.get_drive_strength(
             gpno,
@@ -92,10 +94,62 @@ display_all() {
     fflush(stdout);
 }
 
+//////////////////////////////////////////////////////////////////////
+// Monitor an input by kernel edge events: Each change is reported
+// with its time after the first, and nothing is lost between reads.
+// Returns false if edge events are unavailable.
+//////////////////////////////////////////////////////////////////////
+
+static bool
+monitor_events(int gpno,int seconds) {
+    GPIOEvents events;
+    std::vector<GPIOEvents::s_event> batch;
+    time_t end = time(0) + seconds;
+    uint64_t t0 = 0;
+    unsigned changes = 0;
+    int v0, rc;
+
+    if ( events.watch(gpno,GPIOEvents::Both,"gp") != 0 )
+        return false;
+
+    v0 = events.value(gpno);
+    puts("Monitoring..");
+    printf("%06u GPIO %d = %d\n",changes,gpno,v0);
+
+    // Wake each second to check the end time (or sleep until an edge)
+    while ( seconds <= 0 || time(0) < end ) {
+        batch.clear();
+        rc = events.read(batch,seconds > 0 ? 1000 : -1);
+        if ( rc < 0 ) {
+            fprintf(stderr,"%s: reading GPIO %d events\n",strerror(errno),gpno);
+            break;
+        }
+
+        for ( const GPIOEvents::s_event& ev : batch ) {
+            if ( !t0 )
+                t0 = ev.timestamp_ns;
+            if ( ev.level == v0 )
+                continue;           // Level repeated (edge lost)
+            printf("%06u GPIO %d = %d  +%.6f s\n",++changes,gpno,ev.level,
+                double(ev.timestamp_ns - t0) / 1e9);
+            v0 = ev.level;
+        }
+        fflush(stdout);
+    }
+    puts("Monitoring ended.\n");
+    return true;
+}
+
 static void
 monitor(int gpno,int seconds) {
     time_t end = time(0);
     int v0, v, changes = 0;
+    GPIO::IO io;
+
+    // Edge events make the line an input, so only use them for inputs
+    if ( gpio.alt_function(gpno,io) == 0 && io == GPIO::Input
+      && monitor_events(gpno,seconds) )
+        return;
 
     if ( seconds <= 0 )
         end += 7 * 24 * 3600;
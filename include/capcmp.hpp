@@ -0,0 +1,63 @@
+///////////////////////////////////////////////////////////////////////
+// capcmp.hpp -- Capture Alignment and Comparison
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#ifndef CAPCMP_HPP
+#define CAPCMP_HPP
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <vector>
+
+#define CAPCMP_CHANNELS     32      // One per GPLEV0 bit
+
+class CaptureCompare {
+public:
+    struct s_mismatch {
+        unsigned    channel;        // GPIO #
+        uint64_t    start;          // First differing sample (of a)
+        uint64_t    end;            // Last differing sample + 1
+    };
+
+private:
+    std::vector<s_mismatch> windows; // Ordered by end
+    uint32_t    mask;               // Channels compared
+    unsigned    tolerance;          // Ignore differences this short
+    int64_t     lag;                // b index = a index + lag
+    uint64_t    first;              // First sample of a compared
+    uint64_t    compared;           // Samples compared
+
+public:
+    CaptureCompare();
+
+    inline void set_mask(uint32_t mask) { this->mask = mask; }
+    inline void set_tolerance(unsigned samples) { tolerance = samples; }
+
+    // Lag that lines up the trigger samples of a and b
+    static int64_t align_trigger(uint64_t trigger_a,uint64_t trigger_b);
+
+    // Find the lag (|lag| <= max_lag) best matching channel of b to a:
+    // Returns false if the channel has no edges to line up
+    static bool correlate(const uint32_t *a,size_t na,const uint32_t *b,size_t nb,
+        unsigned channel,uint64_t max_lag,int64_t& lag);
+
+    // XOR compare a[x] against b[x+lag]: Returns the windows found
+    size_t compare(const uint32_t *a,size_t na,const uint32_t *b,size_t nb,int64_t lag);
+
+    inline const std::vector<s_mismatch>& get_windows() const { return windows; }
+    inline int64_t get_lag() const { return lag; }
+    inline uint64_t get_first() const { return first; }
+    inline uint64_t get_compared() const { return compared; }
+
+    void write(FILE *outf,double period_ns) const;  // Report windows
+};
+
+#endif // CAPCMP_HPP
+
+// End capcmp.hpp
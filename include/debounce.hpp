@@ -0,0 +1,53 @@
+//////////////////////////////////////////////////////////////////////
+// debounce.hpp -- Bit-parallel (vertical counter) GPIO debouncer
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#ifndef DEBOUNCE_HPP
+#define DEBOUNCE_HPP
+
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+
+#include "gpio.hpp"
+
+#define DEBOUNCE_PLANES     4       // Counter bits: Up to 15 samples
+#define DEBOUNCE_SAMPLES    4       // Default samples a change must hold
+
+class Debouncer {
+public:
+    // Called for each debounced edge: level is the new level
+    typedef std::function<void(int gpio,int level,uint64_t time_ns)> Edge;
+
+private:
+    uint64_t    mask;               // Pins debounced (bit x is GPIO x)
+    uint64_t    state;              // Debounced levels
+    uint64_t    planes[DEBOUNCE_PLANES]; // Bit k of each pin's counter
+    uint64_t    match[DEBOUNCE_PLANES];  // Plane values at samples
+    unsigned    samples;            // Samples a change must hold
+    Edge        edge;               // Edge callback (may be empty)
+
+public:
+    Debouncer(unsigned samples=DEBOUNCE_SAMPLES,uint64_t mask=~uint64_t(0));
+
+    inline void on_edge(const Edge& callback) { edge = callback; }
+    inline uint64_t get_state() const { return state & mask; }
+    inline uint64_t get_mask() const { return mask; }
+
+    void reset(uint64_t levels);    // Take levels as settled
+
+    // Count one sample: Returns the pins that changed state
+    uint64_t feed(uint64_t levels,uint64_t time_ns=0);
+
+    // Sample gpio every period_us until running is false: Returns 0 or errno
+    int run(GPIO& gpio,unsigned period_us,const std::atomic<bool>& running);
+};
+
+#endif // DEBOUNCE_HPP
+
+// End debounce.hpp
@@ -151,9 +151,16 @@ public:
     DMA();
     ~DMA();
 
+    inline int get_error() { return errcode; }
     inline int get_channel() { return channel; }
     bool set_channel(int ch);
 
+    bool start(uint32_t cb_addr,unsigned priority=8); // Run CB chain
+    void abort();               // Stop and reset the channel
+    bool is_active();           // True while the chain is running
+    bool is_ended();            // True when the chain completed
+    bool is_error();            // True if the channel reports an error
+
     inline uint32_v& u_cs() { return *p_cs; }
     inline uint32_v& u_i() { return *p_ti; }
     inline uint32_v& u_txfr_len() { return *p_txfr_len; }
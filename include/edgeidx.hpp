@@ -0,0 +1,54 @@
+///////////////////////////////////////////////////////////////////////
+// edgeidx.hpp -- Per-Channel Edge Index of a Capture
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#ifndef EDGEIDX_HPP
+#define EDGEIDX_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <vector>
+
+#define EDGEIDX_CHANNELS    32      // One per GPLEV0 bit
+
+class EdgeIndex {
+    std::vector<uint32_t> chan_edges[EDGEIDX_CHANNELS]; // Sorted transition indexes
+    uint32_t    initial;            // Levels of sample 0
+    uint32_t    n_samples;          // Samples indexed
+
+    struct s_range {
+        const uint32_t *samples;
+        size_t      n;
+    };
+
+    void build(const std::vector<s_range>& ranges,unsigned threads);
+
+public:
+    EdgeIndex();
+
+    void clear();
+
+    // Index blocks[] of samps samples each (threads=0 for one per CPU)
+    void build(const std::vector<const uint32_t*>& blocks,size_t samps,unsigned threads=0);
+    void build(const uint32_t *samples,size_t n,unsigned threads=0);
+
+    inline uint32_t get_samples() const { return n_samples; }
+    inline uint32_t get_initial() const { return initial; }
+
+    // Edges of channel with from <= index < to: Returns the count,
+    // and the first edge (sample index of the new level) via *first
+    // (0 when the count is 0)
+    size_t edges(unsigned channel,uint32_t from,uint32_t to,const uint32_t **first=0) const;
+    size_t edges(unsigned channel) const;   // Total edges on channel
+
+    int level(unsigned channel,uint32_t index) const; // Level at sample index
+};
+
+#endif // EDGEIDX_HPP
+
+// End edgeidx.hpp
@@ -13,6 +13,8 @@
 #include <stdint.h>
 
 #define GPIO_CLOCK  4   // Clocks only to GPIO # 4
+#define GPIO_MAX    53  // GPIO 0-31 (bank 0) and 32-53 (bank 1)
+#define GPIO_BANK1_MASK 0x003FFFFF // Bank 1 bits (GPIO 32-53)
 
 typedef uint32_t volatile uint32_v;
 
@@ -87,7 +89,9 @@ public:
 
 private:
 
-    bool        errcode;    // errno if GPIO open failed
+    int         errcode;    // errno if GPIO open failed
+
+    int clock_access();     // 0 when the clock manager is mapped
 
 public:
 
@@ -95,6 +99,7 @@ public:
     ~GPIO();
 
     inline int get_error() { return errcode; } // Test for error
+    uint32_v *registers();              // Mapped GPIO registers (see GPIOPin)
 
     int configure(int gpio,IO io);      // Input/Output
     int configure(int gpio,Pull pull);  // None/Pullup/Pulldown
@@ -107,8 +112,14 @@ public:
     int read(int gpio);		        // Read GPIO into data
     int write(int gpio,int bit);        // Write GPIO
 
-    uint32_t read_events();             // Read all 32 GPIO events
-    uint32_t read();                    // Read all 32 GPIO bits
+    uint32_t read_events();             // Read GPIO 0-31 events
+    uint32_t read();                    // Read GPIO 0-31 bits
+
+    // Multi-pin access: Bit x of each mask is GPIO x (0-53)
+    int write_mask(uint64_t set,uint64_t clear); // Clear, then set pins
+    uint64_t read_mask();               // Read GPIO 0-53 levels
+    uint64_t read_events_mask();        // Read GPIO 0-53 events
+    int clear_events_mask(uint64_t mask); // Clear events of mask
 
     int alt_function(int gpio,IO& io);
     int get_drive_strength(int gpio,bool& slew_limited,bool& hysteresis,int &drive);
@@ -127,6 +138,7 @@ public:
     int pwm_status(int gpio,s_PWM_status& status);
     int pwm_ratio(int gpio,uint32_t m,uint32_t s);
     int pwm_enable(int gpio,bool enable);
+    int pwm_dma(int gpio,bool enable,unsigned dreq=1,unsigned panic=1);
     int pwm_clear_status(int gpio,const s_PWM_status& status);
     int pwm_write_fifo(int gpio,uint32_t *data,size_t& n_words);
     bool pwm_fifo_full(int gpio);
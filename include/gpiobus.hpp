@@ -0,0 +1,41 @@
+//////////////////////////////////////////////////////////////////////
+// gpiobus.hpp -- Parallel bus on an arbitrary group of GPIO pins
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#ifndef GPIOBUS_HPP
+#define GPIOBUS_HPP
+
+#include <stdint.h>
+
+#include "gpio.hpp"
+
+#define GPIOBUS_MAX_BITS    32      // Widest bus value
+
+class GPIOBus {
+    GPIO&       gpio;               // GPIO access
+    int         pins[GPIOBUS_MAX_BITS]; // GPIO # of each bit (LSB first)
+    unsigned    n_bits;             // Bus width
+    uint64_t    mask;               // All bus pins
+    uint64_t    nibbles[GPIOBUS_MAX_BITS/4][16]; // Pin masks by value nibble
+    int         errcode;            // EINVAL for a bad pin list
+
+public:
+    GPIOBus(GPIO& gpio,const int *pins,unsigned n_bits);
+
+    inline int get_error() { return errcode; }
+    inline unsigned get_bits() { return n_bits; }
+    inline uint64_t get_mask() { return mask; }
+
+    int configure(GPIO::IO io);     // Set direction of all bus pins
+    uint64_t pin_mask(uint32_t value); // Bus pins high for value
+    int write(uint32_t value);      // Drive value onto the bus
+    uint32_t read();                // Read the bus pins as a value
+};
+
+#endif // GPIOBUS_HPP
+
+// End gpiobus.hpp
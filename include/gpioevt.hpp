@@ -0,0 +1,60 @@
+//////////////////////////////////////////////////////////////////////
+// gpioevt.hpp -- Kernel timestamped GPIO edge events
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#ifndef GPIOEVT_HPP
+#define GPIOEVT_HPP
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "gpio.hpp"
+
+#define GPIOEVT_CHIP        "/dev/gpiochip0" // Lines 0-53 are GPIO 0-53
+#define GPIOEVT_BATCH       16      // Events read per line per call
+
+class GPIOEvents {
+public:
+    enum Edge {                     // Edges to report:
+        Rising=1,
+        Falling=2,
+        Both=3
+    };
+
+    struct s_event {
+        uint64_t    timestamp_ns;   // Kernel time of the edge
+        int         gpio;           // GPIO #
+        int         level;          // Level after the edge
+    };
+
+private:
+    int         chip_fd;            // GPIO character device
+    int         fds[GPIO_MAX+1];    // Line event fd by GPIO (-1 if none)
+    std::vector<int> watched;       // GPIOs with an fd, in watch() order
+    int         errcode;            // errno if the chip did not open
+
+public:
+    GPIOEvents(const char *chip=GPIOEVT_CHIP);
+    ~GPIOEvents();
+
+    inline int get_error() { return errcode; }
+
+    // Request edge events (the line becomes an input): Returns 0 or errno
+    int watch(int gpio,Edge edge=Both,const char *consumer="librpi2");
+    int unwatch(int gpio);
+    int value(int gpio);            // Current level, or -1 (see errno)
+    inline int get_fd(int gpio) { return gpio >= 0 && gpio <= GPIO_MAX ? fds[gpio] : -1; }
+
+    // Wait up to timeout_ms (-1 forever) for events of all watched lines,
+    // appended in time order: Returns the count, 0 on timeout, -1 on error
+    int read(std::vector<s_event>& events,int timeout_ms);
+};
+
+#endif // GPIOEVT_HPP
+
+// End gpioevt.hpp
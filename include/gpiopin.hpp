@@ -0,0 +1,61 @@
+//////////////////////////////////////////////////////////////////////
+// gpiopin.hpp -- Compile-time specialized GPIO pin handle
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#ifndef GPIOPIN_HPP
+#define GPIOPIN_HPP
+
+#include <stdint.h>
+
+#include "gpio.hpp"
+
+//////////////////////////////////////////////////////////////////////
+// GPIOPin<N>: The bank, register word offsets and bit mask of GPIO N
+// are constants, so set(), clear() and read() inline to one store or
+// load through the GPIO register mapping (no division, range or error
+// checks). The GPIO instance must stay open while the pin is in use.
+//
+//  GPIO gpio;
+//  GPIOPin<17> led(gpio);
+//
+//  led.set();
+//////////////////////////////////////////////////////////////////////
+
+template <unsigned N>
+class GPIOPin {
+    static_assert(N <= GPIO_MAX,"GPIOPin<N>: N must be 0 to GPIO_MAX");
+
+    uint32_v    *regs;      // GPIO registers (nullptr if not mapped)
+
+public:
+    static const unsigned   pin = N;
+    static const unsigned   bank = N / 32;
+    static const uint32_t   mask = uint32_t(1) << ( N % 32 );
+
+    enum : unsigned {       // Word offsets of this pin's registers
+        GPSET = 0x1C / 4 + bank,
+        GPCLR = 0x28 / 4 + bank,
+        GPLEV = 0x34 / 4 + bank,
+        GPEDS = 0x40 / 4 + bank
+    };
+
+    GPIOPin(GPIO& gpio) : regs(gpio.registers()) { }
+
+    inline bool ok() const { return regs != nullptr; }
+
+    inline void set() { regs[GPSET] = mask; }
+    inline void clear() { regs[GPCLR] = mask; }
+    inline void write(bool bit) { regs[bit ? GPSET : GPCLR] = mask; }
+    inline bool read() const { return ( regs[GPLEV] & mask ) != 0; }
+
+    inline bool event() const { return ( regs[GPEDS] & mask ) != 0; }
+    inline void clear_event() { regs[GPEDS] = mask; }
+};
+
+#endif // GPIOPIN_HPP
+
+// End gpiopin.hpp
@@ -10,13 +10,31 @@
 #ifndef LOGANA_HPP
 #define LOGANA_HPP
 
-#include "mailbox.hpp"
-#include "rpidma.h"
+#include "gpio.hpp"
 #include "dma.hpp"
+#include "pacer.hpp"
+#include "rlecap.hpp"
+#include "edgeidx.hpp"
+#include "sigstats.hpp"
+#include "sumpyr.hpp"
+#include "rawcap.hpp"
+#include "rpidma.h"
 
+#include <string>
 #include <vector>
 
 #define LOGANA_PATH	"/dev/logana"
+#define LOGANA_PACE_CHAN 14         // DMA channel used for paced sampling
+#define LOGANA_ST_CLO   0x7E003004  // System timer (1 MHz) counter low
+
+//////////////////////////////////////////////////////////////////////
+// A timestamped sample (see set_timestamps())
+//////////////////////////////////////////////////////////////////////
+
+struct s_logana_stamp {
+    uint32_t    st_clo;     // System timer (usec) when sampled
+    uint32_t    levels;     // Sample (GPLEV0)
+};
 
 class LogicAnalyzer {
     uint32_t            pagespblk;  // Pages per block
@@ -25,15 +43,31 @@ class LogicAnalyzer {
 
     std::vector<void*> dma_blocks;  // Memory blocks for use with DMA
 
-    std::vector<uint32_t>  sg_list;    // Scatter/Gather list
-
     int                 fd;         // /dev/rpidma
-    s_rpidma_ioctl      dalloc;     // DMA Allocation
+    s_rpidma_ring       ring;       // Driver allocated buffer ring
+    void                *ring_map;  // mmap() of buffer ring
     std::string         errmsg;     // Error message
-    DmaMem              dmamem;     // DMA Memory
-    DMA                 dma;        // DMA registers + CB
     GPIO                gpio;       // GPIO access
 
+    uint32_t            dreq;       // DREQ for driver transfers (0=none)
+    unsigned            seg_first;  // First block of segment
+    unsigned            seg_blocks; // Blocks in segment (0=all)
+    double              rate;       // Paced sample rate (Hz), 0=free running
+    bool                stamps;     // Capture (ST_CLO,levels) pairs
+    int                 pace_chan;  // DMA channel for paced sampling
+    int                 cb_fd;      // /dev/rpidma for CB chain
+    s_rpidma_ring       cb_ring;    // Driver allocated CB memory
+    void                *cb_map;    // mmap() of CB memory
+    DMA                 *dma;       // Raw DMA channel (CB chain)
+    Pacer               *pacer;     // PWM timebase (paced)
+
+    void free_blocks();
+    void free_chain();
+    void mark_1stblock();
+    void set_ioctl(s_rpidma_ioctl& rpidma,unsigned long src_addr,std::vector<uint32_t>& dsts);
+    bool prepare_chain(unsigned long src_addr);
+    inline bool chained() { return rate > 0.0 || stamps; }
+
 public:
     LogicAnalyzer(unsigned arg_ppblk=8);
     ~LogicAnalyzer();
@@ -46,14 +80,40 @@ public:
 
     bool alloc_blocks(unsigned blocks);
 
+    inline void set_dreq(uint32_t dreq_id) { dreq = dreq_id; }
+    bool set_segment(unsigned first_block,unsigned n_blocks); // 0,0 for all
+    inline void set_pace_channel(int ch) { pace_chan = ch; }
+    // Paced or timestamped sampling also allocates a 32 byte CB per
+    // sample for each of pacing, timestamp and copy: 16x the sample
+    // memory when paced, 8x stamped, 12x both
+    inline void set_rate(double hz) { rate = hz > 0.0 ? hz : 0.0; }
+    inline double get_rate() { return rate; } // Actual, once prepared
+    inline void set_timestamps(bool on) { stamps = on; }
+    inline bool get_timestamps() { return stamps; }
+
     bool start(unsigned long src_addr); // Start the DMA
-    bool read_1stblock();       // True if the first block has been read
+    bool prepare(unsigned long src_addr); // Prepare DMA for restart()
+    bool restart();             // Re-arm prepared DMA
+    bool start_cyclic(unsigned long src_addr); // Start cyclic DMA (ring)
+    int next_period(s_rpidma_period& period,int timeout_ms=-1);
+    bool read_1stblock();       // True if the first block (of segment) has been read
     int is_completed();		// 1==completed, 0==incomplete or < 0 is error
     void cancel();              // Cancel current DMA transfer (if any)
+    double sample_period();     // Measured ns per sample, else 0.0
+    bool driver_stats(s_rpidma_stats& stats,bool global=false); // Driver counters
 
     inline size_t get_blocks() { return dma_blocks.size(); }
 
     uint32_t *get_samples(unsigned blockx,size_t *n_samples);
+    s_logana_stamp *get_stamps(size_t *n_stamps);
+    // These treat all blocks as one capture: Segments (set_segment())
+    // are joined end to end, with false edges at each boundary
+    bool encode(RLECapture& rle);  // Append capture as runs
+    bool index(EdgeIndex& idx,unsigned threads=0); // Build edge lists
+    bool statistics(SignalStats& stats);  // Per-channel statistics
+    bool summarize(SummaryPyramid& pyr);  // Zoom level summaries
+    bool save_raw(const char *path,uint64_t trigger=RAWCAP_NO_TRIGGER); // Raw capture file
+    bool sample_times(std::vector<double>& t_ns);
 };
 
 #endif // LOGANA_HPP
@@ -17,6 +17,9 @@ class MAX7219 {
     int         pin_clk;    // GPIO pin used for CLK
     int         pin_din;    // GPIO pin used for DIN
     int         pin_load;   // GPIO pin used for LOAD
+    uint64_t    m_clk;      // GPIO::write_mask() bit for CLK
+    uint64_t    m_din;      // .. for DIN
+    uint64_t    m_load;     // .. for LOAD
 
     unsigned    decodes;    // 1=decode, 0=no decode (bits 0-7)
     unsigned    duty_cfg;   // For 7219: 0-31
@@ -0,0 +1,41 @@
+///////////////////////////////////////////////////////////////////////
+// pacer.hpp -- DMA Pacer Class (PWM FIFO as a DREQ timebase)
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#ifndef PACER_HPP
+#define PACER_HPP
+
+#include "gpio.hpp"
+#include "dma.hpp"
+
+#define PACER_GPIO      12          // PWM0 (the pin is not configured)
+#define PACER_DIVI      50          // PLLD 500 MHz / 50 = 10 MHz
+#define PACER_CLOCK     (500000000.0/PACER_DIVI)
+
+class Pacer {
+    GPIO        gpio;       // PWM and clock access
+    double      rate;       // Actual rate (Hz) or 0 when stopped
+
+public:
+    Pacer();
+    ~Pacer();
+
+    inline int get_error() { return gpio.get_error(); }
+
+    int start(double rate_hz);  // Drain PWM FIFO at rate_hz
+    void stop();
+    inline double get_rate() { return rate; }
+
+    // A DMA CB writing a dummy word to fifo_addr() with DEST_DREQ
+    // and PERMAP = dreq() stalls until the next pacer tick:
+    static inline unsigned dreq() { return DMA::DREQ_5; }
+    static inline uint32_t fifo_addr() { return 0x7E20C018; } // PWM_FIF1
+};
+
+#endif // PACER_HPP
+
+// End pacer.hpp
@@ -0,0 +1,53 @@
+//////////////////////////////////////////////////////////////////////
+// patgen.hpp -- DMA Pattern Generator (memory to peripheral)
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#ifndef PATGEN_HPP
+#define PATGEN_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "rpidma.h"
+
+#include <string>
+
+class PatternGen {
+    int                 fd;         // /dev/rpidma4x
+    s_rpidma_ring       ring;       // Driver allocated buffer ring
+    void                *ring_map;  // mmap() of buffer ring
+    uint32_t            dreq;       // DREQ pacing the writes (0=none)
+    std::string         errmsg;     // Error message
+
+    bool request(int cmd,uint32_t dev_addr);
+
+public:
+    PatternGen();
+    ~PatternGen();
+
+    inline const char *error() { return errmsg.c_str(); }
+    bool open();                // Open driver
+    void close();               // Close driver
+
+    bool alloc_buffers(unsigned n_bufs,uint32_t buf_sz); // buf_sz: page multiple
+    void free_buffers();
+
+    inline unsigned get_buffers() { return ring.n_bufs; }
+    uint32_t *get_buffer(unsigned bufx,size_t *n_words);
+
+    inline void set_dreq(uint32_t dreq_id) { dreq = dreq_id; }
+
+    bool start(uint32_t dev_addr);        // Write all buffers once
+    bool start_cyclic(uint32_t dev_addr); // Repeat buffers until cancel()
+    int next_period(s_rpidma_period& period,int timeout_ms=-1);
+    int is_completed();         // 1==completed, 0==incomplete or < 0 is error
+    void cancel();              // Cancel current DMA transfer (if any)
+};
+
+#endif // PATGEN_HPP
+
+// End patgen.hpp
@@ -0,0 +1,74 @@
+///////////////////////////////////////////////////////////////////////
+// protodec.hpp -- UART, SPI and I2C Decoders for Captures
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#ifndef PROTODEC_HPP
+#define PROTODEC_HPP
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "edgeidx.hpp"
+
+class ProtoDecoder {
+public:
+    enum Kind {
+        UART_Byte,          // data = byte received
+        SPI_Word,           // data = MOSI, data2 = MISO
+        I2C_Start,          // (Repeated) start condition
+        I2C_Stop,           // Stop condition
+        I2C_Byte            // data = byte (address byte after start)
+    };
+
+    enum Flags {
+        FramingErr = 0x01,  // UART stop bit was low
+        Ack = 0x02,         // I2C byte was ACKed
+        Address = 0x04,     // I2C address byte
+        Read = 0x08,        // I2C address with R/W = 1
+        Partial = 0x10      // SPI word cut short by CS
+    };
+
+    struct s_frame {
+        uint32_t    start;  // Sample index of first bit/event
+        uint32_t    end;    // Sample index after last bit
+        Kind        kind;
+        uint32_t    data;
+        uint32_t    data2;
+        unsigned    flags;
+    };
+
+    // UART 8N1, idle high: bit_samples=0.0 auto-bauds
+    static double uart_autobaud(const EdgeIndex& idx,unsigned rx);
+    static size_t uart(const EdgeIndex& idx,unsigned rx,double bit_samples,std::vector<s_frame>& frames);
+
+    // SPI mode 0-3, MSB first, CS active low (cs < 0 for none),
+    // mosi/miso < 0 when not captured
+    static size_t spi(
+        const EdgeIndex& idx,
+        int cs,
+        unsigned sck,
+        int mosi,
+        int miso,
+        unsigned mode,
+        std::vector<s_frame>& frames,
+        unsigned bits=8,
+        unsigned threads=0);
+
+    // I2C: Start/stop, bytes and ACK/NAK
+    static size_t i2c(const EdgeIndex& idx,unsigned scl,unsigned sda,std::vector<s_frame>& frames);
+
+    // Text (csv=false) or CSV report, timestamped with period_ns
+    static void write(FILE *outf,const std::vector<s_frame>& frames,double period_ns,bool csv);
+
+    static const char *kind_name(Kind kind);
+};
+
+#endif // PROTODEC_HPP
+
+// End protodec.hpp
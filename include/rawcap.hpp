@@ -0,0 +1,44 @@
+///////////////////////////////////////////////////////////////////////
+// rawcap.hpp -- Raw Capture Files (GPLEV0 sample words)
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#ifndef RAWCAP_HPP
+#define RAWCAP_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <vector>
+
+#define RAWCAP_NO_TRIGGER   (~uint64_t(0))  // Capture was not triggered
+
+class RawCapture {
+    std::vector<uint32_t> samples;  // GPLEV0 words, in time order
+    double      period_ns;          // ns per sample
+    uint64_t    trigger;            // Trigger sample, or RAWCAP_NO_TRIGGER
+
+public:
+    RawCapture();
+
+    void clear();
+
+    // Write blocks[] of samps samples each to path: Returns 0 or errno
+    static int write(const char *path,const std::vector<const uint32_t*>& blocks,size_t samps,
+        double period_ns,uint64_t trigger=RAWCAP_NO_TRIGGER);
+
+    int load(const char *path);     // Returns 0 or errno
+
+    inline const uint32_t *data() const { return samples.data(); }
+    inline size_t get_samples() const { return samples.size(); }
+    inline double get_period() const { return period_ns; }
+    inline uint64_t get_trigger() const { return trigger; }
+    inline bool triggered() const { return trigger != RAWCAP_NO_TRIGGER; }
+};
+
+#endif // RAWCAP_HPP
+
+// End rawcap.hpp
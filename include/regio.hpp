@@ -0,0 +1,104 @@
+///////////////////////////////////////////////////////////////////////
+// regio.hpp -- Peripheral Register Access Backends
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#ifndef REGIO_HPP
+#define REGIO_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include <map>
+
+#include "gpio.hpp"
+
+#define REGIO_ENV       "RPI2_REGIO" // "sim" selects RegIOSim at first use
+
+//////////////////////////////////////////////////////////////////////
+// Where GPIO and DMA get their register pointers from. Select the
+// backend before the first GPIO or DMA instance is constructed.
+//////////////////////////////////////////////////////////////////////
+
+class RegIO {
+public:
+    virtual ~RegIO() {}
+
+    // Map bytes of registers at physical offset: nullptr + errno if failed
+    virtual void *map(off_t offset,size_t bytes) = 0;
+    virtual int unmap(void *addr,size_t bytes) = 0;
+
+    virtual bool simulated() const { return false; }
+    virtual void stored(uint32_v *reg) { }  // Register reg was written
+
+    static RegIO *backend();            // The selected backend
+    static RegIO *select(RegIO *regio); // Returns the previous backend
+};
+
+//////////////////////////////////////////////////////////////////////
+// The hardware: One process-wide mapping of the peripheral window
+// from /dev/mem (needs root) that map() carves pointers from, and
+// that the last unmap() releases. Without /dev/mem access, the GPIO
+// block alone is mapped from /dev/gpiomem.
+//////////////////////////////////////////////////////////////////////
+
+class RegIOMem : public RegIO {
+public:
+    void *map(off_t offset,size_t bytes);
+    int unmap(void *addr,size_t bytes);
+
+    static bool gpio_only();            // True when using /dev/gpiomem
+};
+
+//////////////////////////////////////////////////////////////////////
+// In-memory register image: Each stored() applies the side effects
+// of GPSETn/GPCLRn (levels of output pins), GPEDSn (write 1 to clear,
+// events from the enabled detectors), GPPUD/GPUDCLKn (pulls of input
+// pins), the pad and clock manager passwords (0x5A), CM_xxCTL BUSY
+// and PWM STA. DMA channels do not run. Stores that bypass the GPIO
+// class (GPIOPin) take effect at the next stored() or settle().
+//////////////////////////////////////////////////////////////////////
+
+class RegIOSim : public RegIO {
+    struct s_block {
+        uint32_t    *image;             // Register words
+        size_t      bytes;              // Size of image
+        uint32_t    *shadow;            // Accepted values (password regs)
+    };
+
+    std::map<uint32_t,s_block> blocks;  // By offset in peripheral window
+    uint32_t    out[2];                 // Output latches (GPSET/GPCLR)
+    uint32_t    in[2];                  // Input pin levels (drive/pulls)
+    uint32_t    prev[2];                // Last GPLEVn, for edges
+    uint32_t    eds[2];                 // Pending GPEDSn events
+    uint64_t    n_stores;               // stored() calls
+
+    uint32_t *word(uint32_t bus_addr,uint32_t **shadow=nullptr);
+    void settle_gpio(uint32_v *reg);
+    void settle_passwd(uint32_t bus_addr,unsigned n_words);
+    void settle_clocks();
+    void settle_pwm(uint32_v *reg);
+
+public:
+    RegIOSim();
+    ~RegIOSim();
+
+    void *map(off_t offset,size_t bytes);
+    int unmap(void *addr,size_t bytes); // Images persist until destroyed
+
+    bool simulated() const { return true; }
+    void stored(uint32_v *reg);
+    void settle();                      // Apply pending stores
+
+    uint32_v *reg(uint32_t bus_addr);   // Register 0x7Exxxxxx (nullptr if unmapped)
+    void drive(int gpio,bool level);    // Level of an input pin
+    inline uint64_t get_stores() const { return n_stores; }
+};
+
+#endif // REGIO_HPP
+
+// End regio.hpp
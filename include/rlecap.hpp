@@ -0,0 +1,70 @@
+///////////////////////////////////////////////////////////////////////
+// rlecap.hpp -- Run-Length Encoded Capture Class
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#ifndef RLECAP_HPP
+#define RLECAP_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////
+// One run of identical samples
+//////////////////////////////////////////////////////////////////////
+
+struct s_rle_run {
+    uint32_t    value;      // Sample (GPLEV0)
+    uint32_t    count;      // # of consecutive samples (>= 1)
+};
+
+class RLECapture {
+    std::vector<s_rle_run> runs;    // Encoded capture
+    uint64_t    n_samples;          // Total samples encoded
+
+public:
+    RLECapture();
+
+    void clear();
+    void append(const uint32_t *samples,size_t n); // Encode more samples
+
+    inline size_t get_runs() const { return runs.size(); }
+    inline uint64_t get_samples() const { return n_samples; }
+    inline size_t get_bytes() const { return runs.size() * sizeof(s_rle_run); }
+    inline const s_rle_run *data() const { return runs.data(); }
+
+    uint32_t sample(uint64_t index) const; // Random access (scans the runs)
+
+    //////////////////////////////////////////////////////////////////
+    // Iterates over the runs, tracking the index of each run's
+    // first sample:
+    //////////////////////////////////////////////////////////////////
+
+    class iterator {
+        const s_rle_run *runp;
+        uint64_t    start;          // Sample index of *runp
+
+    public:
+        iterator(const s_rle_run *p,uint64_t s) : runp(p), start(s) {}
+
+        inline uint64_t index() const { return start; }
+        inline uint32_t value() const { return runp->value; }
+        inline uint32_t count() const { return runp->count; }
+
+        inline iterator& operator++() { start += runp->count; ++runp; return *this; }
+        inline bool operator!=(const iterator& other) const { return runp != other.runp; }
+        inline const iterator& operator*() const { return *this; }
+    };
+
+    inline iterator begin() const { return iterator(runs.data(),0); }
+    inline iterator end() const { return iterator(runs.data()+runs.size(),n_samples); }
+};
+
+#endif // RLECAP_HPP
+
+// End rlecap.hpp
@@ -15,12 +15,79 @@
 /* Linux 4.X version */
 
 struct s_rpidma_ioctl {
-    uint32_t    slave_id;   /* Slave ID to assign */
+    uint32_t    slave_id;   /* Slave ID to assign (DREQ, 0 is none) */
     uint32_t    page_sz;    /* Size of each page */
     uint32_t    src_addr;   /* One source address */
     uint32_t    n_dst;      /* # of destination addresses */
     uint32_t    *pdst_addr; /* Ptr to first designation address */
+    uint32_t    direction;  /* RPIDMA_DEV_TO_MEM or RPIDMA_MEM_TO_DEV */
+};
+
+/*
+ * Transfer direction: RPIDMA_DEV_TO_MEM reads the peripheral register
+ * at src_addr into the buffers. RPIDMA_MEM_TO_DEV instead writes the
+ * buffers' words to the peripheral register at src_addr (for example
+ * a FIFO), paced by the slave_id DREQ. The buffer list (pdst_addr, or
+ * the ring when n_dst is 0) is used the same way for both.
+ */
+#define RPIDMA_DEV_TO_MEM   0
+#define RPIDMA_MEM_TO_DEV   1
+
+/*
+ * RPIDMA_ALLOC: Driver allocated (DMA coherent) buffer ring. The
+ * n_bufs buffers are contiguous and are accessed by mmap(2) of the
+ * device, buffer x at offset x * buf_sz. A RPIDMA_START or
+ * RPIDMA_CYCLIC with n_dst == 0 uses this ring as its destination.
+ */
+struct s_rpidma_ring {
+    uint32_t    n_bufs;     /* # of buffers in ring (0 frees) */
+    uint32_t    buf_sz;     /* Bytes per buffer (page multiple) */
+    uint32_t    bus_addr;   /* Returned: Bus address of buffer 0 */
+    uint32_t    size;       /* Returned: mmap(2) length of ring */
+};
+
+/*
+ * read(2) of /dev/rpidma4x in cyclic mode returns one of these
+ * for each completed period (page_sz bytes) of the buffer ring.
+ * With RPIDMA_MEM_TO_DEV, a completed period may be refilled.
+ */
+struct s_rpidma_period {
+    uint32_t    period;     /* Running count of this period */
+    uint32_t    index;      /* Ring index (0 .. n_dst-1) of this period */
+    uint32_t    overruns;   /* Total periods lost to overrun */
+};
+
+/*
+ * RPIDMA_TIMING: Timing of the last completed (non-cyclic) transfer,
+ * from its submission until the completion callback. Dividing
+ * elapsed_ns by the transfer count gives the actual sample period.
+ */
+struct s_rpidma_timing {
+    uint32_t    bytes;      /* Bytes transferred */
+    uint32_t    elapsed_ns; /* Submit to completion (ns) */
+};
+
+/*
+ * RPIDMA_STATS / RPIDMA_GSTATS: Transfer counters for this open file,
+ * or for all files since the module was loaded. Latencies are
+ * counted in log2 histograms of microseconds: Bucket x counts
+ * latencies from 2^x up to 2^(x+1)-1 usec (bucket 0 includes 0).
+ * The first byte is when progress was first seen: By a RPIDMA_STATUS
+ * poll finding a reduced residue, or the first cyclic period.
+ */
+#define RPIDMA_HIST_BUCKETS 32
 
+struct s_rpidma_stats {
+    uint32_t    submits;        /* Transfers submitted */
+    uint32_t    completions;    /* Non-cyclic transfers completed */
+    uint32_t    periods;        /* Cyclic periods completed */
+    uint32_t    errors;         /* Failed submissions and DMA errors */
+    uint64_t    bytes;          /* Bytes moved (completions + periods) */
+    uint32_t    first_n;        /* Transfers with a first byte time */
+    uint32_t    first_max_us;   /* Longest submit to first byte */
+    uint64_t    first_sum_us;   /* Total, for the mean */
+    uint32_t    first_hist[RPIDMA_HIST_BUCKETS]; /* Submit to first byte */
+    uint32_t    done_hist[RPIDMA_HIST_BUCKETS];  /* Submit to completion */
 };
 
 /*
@@ -28,7 +95,15 @@ struct s_rpidma_ioctl {
  */
 #define RPIDMA_START    200 /* Allocate and start DMA */
 #define RPIDMA_STATUS   201 /* Query completion status */
-#define RPIDMA_CANCEL   202 /* Cancel DMA operation, if any */
+#define RPIDMA_CANCEL   202 /* Cancel DMA operation, if any (keeps channel) */
+#define RPIDMA_CYCLIC   203 /* Start cyclic DMA over contiguous ring */
+#define RPIDMA_ALLOC    204 /* Allocate mmap-able buffer ring */
+#define RPIDMA_PREPARE  205 /* Like RPIDMA_START, but don't start */
+#define RPIDMA_RESTART  206 /* (Re)start the last prepared transfer */
+#define RPIDMA_TIMING   207 /* Timing of last completed transfer */
+#define RPIDMA_STATS    208 /* Counters for this open file */
+#define RPIDMA_GSTATS   209 /* Counters for all files */
+#define RPIDMA_CLRSTATS 210 /* Clear counters for this open file */
 
 #endif
 
@@ -0,0 +1,73 @@
+//////////////////////////////////////////////////////////////////////
+// sampler.hpp -- Real-time GPIO level sampler thread
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#ifndef SAMPLER_HPP
+#define SAMPLER_HPP
+
+#include <stdint.h>
+
+#include <atomic>
+#include <thread>
+
+#include "gpio.hpp"
+#include "spscring.hpp"
+
+#define SAMPLER_RING        65536   // Default ring slots (changes)
+#define SAMPLER_PRIORITY    50      // Default SCHED_FIFO priority
+#define SAMPLER_SPIN_NS     100000  // Shorter periods spin, not sleep
+
+class Sampler {
+public:
+    struct s_sample {
+        uint64_t    time_ns;        // CLOCK_MONOTONIC of the sample
+        uint64_t    levels;         // GPIO 0-53 levels (bit x is GPIO x)
+    };
+
+private:
+    GPIO&       gpio;               // Level access
+    SPSCRing<s_sample> ring;        // Changes, for one consumer
+    std::thread thread;             // Sampling thread
+    std::atomic<bool> running;      // Cleared to stop the thread
+    std::atomic<bool> started;      // Thread finished its setup
+    uint64_t    period_ns;          // Sample period
+    int         cpu;                // CPU pinned to (-1 for any)
+    int         priority;           // SCHED_FIFO priority
+    int         sched_err;          // errno if not real-time/pinned
+
+    std::atomic<uint64_t> n_samples;    // Samples taken
+    std::atomic<uint64_t> n_changes;    // Samples pushed
+    std::atomic<uint64_t> n_overruns;   // Pushes delayed by a full ring
+    std::atomic<uint64_t> n_late;       // Periods missed
+
+    void run();
+
+public:
+    Sampler(GPIO& gpio,size_t ring_slots=SAMPLER_RING);
+    ~Sampler();
+
+    // Start sampling: Returns 0 or errno (EINVAL, EBUSY if running)
+    int start(uint64_t period_ns,int cpu=-1,int priority=SAMPLER_PRIORITY);
+    void stop();
+
+    inline bool is_running() const { return running.load(); }
+    inline int get_sched_error() const { return sched_err; }
+
+    // Consumer side (one thread): Never blocks the sampler
+    inline bool pop(s_sample& sample) { return ring.pop(sample); }
+    inline size_t read(s_sample *samples,size_t max) { return ring.pop(samples,max); }
+    inline size_t pending() const { return ring.size(); }
+
+    inline uint64_t get_samples() const { return n_samples.load(); }
+    inline uint64_t get_changes() const { return n_changes.load(); }
+    inline uint64_t get_overruns() const { return n_overruns.load(); }
+    inline uint64_t get_late() const { return n_late.load(); }
+};
+
+#endif // SAMPLER_HPP
+
+// End sampler.hpp
@@ -0,0 +1,60 @@
+///////////////////////////////////////////////////////////////////////
+// sigstats.hpp -- Per-Channel Signal Statistics for Captures
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#ifndef SIGSTATS_HPP
+#define SIGSTATS_HPP
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define SIGSTATS_CHANNELS   32      // One per GPLEV0 bit
+
+class SignalStats {
+public:
+    struct s_chanstats {
+        uint32_t    edges;          // Total transitions
+        uint32_t    rising;         // Rising transitions
+        uint64_t    high;           // Samples spent high
+        uint32_t    min_high;       // Narrowest complete high pulse
+        uint32_t    max_high;       // Widest complete high pulse
+        uint32_t    min_low;        // Narrowest complete low pulse
+        uint32_t    max_low;        // Widest complete low pulse
+        uint64_t    first_rise;     // Sample index of first rising edge
+        uint64_t    last_rise;      // Sample index of last rising edge
+        uint64_t    last_edge;      // Sample index of last edge
+    };
+
+private:
+    s_chanstats chans[SIGSTATS_CHANNELS];
+    uint64_t    n_samples;          // Samples processed
+    uint64_t    total_edges;        // Edges over all channels
+    uint32_t    prev;               // Last sample processed
+    bool        done;               // finish() called
+
+public:
+    SignalStats();
+
+    void clear();
+    void feed(const uint32_t *samples,size_t n); // Stream blocks in order
+    void finish();                  // Account for the final levels
+
+    inline uint64_t get_samples() const { return n_samples; }
+    inline uint64_t get_edges() const { return total_edges; }
+    inline const s_chanstats& channel(unsigned ch) const { return chans[ch]; }
+
+    double frequency(unsigned ch,double period_ns) const; // Hz, 0 if < 2 rising
+    double duty(unsigned ch) const;                     // Fraction high
+
+    void write_table(FILE *outf,double period_ns,bool all=false) const;
+    void write_json(FILE *outf,double period_ns) const;
+};
+
+#endif // SIGSTATS_HPP
+
+// End sigstats.hpp
@@ -0,0 +1,69 @@
+//////////////////////////////////////////////////////////////////////
+// softpwm.hpp -- DMA driven soft PWM and servo pulses on any GPIO
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#ifndef SOFTPWM_HPP
+#define SOFTPWM_HPP
+
+#include <stdint.h>
+
+#include <string>
+
+#include "gpio.hpp"
+#include "dma.hpp"
+#include "pacer.hpp"
+
+#define SPWM_CHAN           12      // DMA channel (Waveform uses 13)
+#define SPWM_PERIOD_US      20000   // Default period: 50 Hz servo frame
+#define SPWM_STEP_US        10      // Default resolution
+
+class SoftPWM {
+    struct s_slot {
+        uint32_t    mask[2];        // GPIO 0-31, 32-53 (GPSETn or GPCLRn)
+    };
+
+    GPIO        gpio;               // Drives pins low at close()
+    DMA         *dma;               // Channel, and DmaMem allocations
+    Pacer       *pacer;             // Slot timebase (PWM DREQ)
+    DMA::CB     *cbs;               // Write and pace CB per slot
+    s_slot      *slots;             // Slot 0 sets, the rest clear
+    uint32_t    cb_bus;             // Bus address of cbs[0]
+    unsigned    n_slots;            // Slots per period
+    double      step_us;            // Actual slot time
+    unsigned    clear_at[GPIO_MAX+1]; // Clearing slot per pin, or 0
+    bool        high[GPIO_MAX+1];   // Pin is in slot 0's set mask
+    int         channel;            // DMA channel
+    std::string errmsg;             // Error message
+
+    int current_slot();             // Slot the DMA is in, or -1
+    void move_clear(int gpio,unsigned slot);
+
+public:
+    SoftPWM();
+    ~SoftPWM();
+
+    inline const char *error() { return errmsg.c_str(); }
+    inline void set_channel(int ch) { channel = ch; }
+
+    // Start the period with all pins idle (low)
+    bool open(unsigned period_us=SPWM_PERIOD_US,unsigned step_us=SPWM_STEP_US);
+    void close();
+
+    inline unsigned get_slots() { return n_slots; }
+    inline double get_step() { return step_us; }
+    inline double get_period() { return n_slots * step_us; }
+
+    // High time of each period (0 = low, >= period = high), rounded
+    // to a whole step. The pin must be configured as an Output.
+    bool set_width(int gpio,double us);
+    bool set_duty(int gpio,double fraction);
+    double get_width(int gpio);
+};
+
+#endif // SOFTPWM_HPP
+
+// End softpwm.hpp
@@ -0,0 +1,87 @@
+//////////////////////////////////////////////////////////////////////
+// spscring.hpp -- Lock-free single producer, single consumer ring
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#ifndef SPSCRING_HPP
+#define SPSCRING_HPP
+
+#include <stddef.h>
+
+#include <atomic>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////
+// One thread may push() and one other thread may pop(): Neither ever
+// blocks or locks. head and tail count items without wrapping, and
+// are kept on separate cache lines so the two sides do not contend.
+//////////////////////////////////////////////////////////////////////
+
+template <typename T>
+class SPSCRing {
+    std::vector<T>      slots;      // Power of 2 slots
+    size_t              mask;       // slots.size() - 1
+    char                pad0[64];
+    std::atomic<size_t> head;       // Items pushed (producer)
+    char                pad1[64];
+    std::atomic<size_t> tail;       // Items popped (consumer)
+    char                pad2[64];
+
+public:
+    SPSCRing(size_t capacity) : head(0), tail(0) {
+        size_t n = 2;
+
+        while ( n < capacity )
+            n <<= 1;
+        slots.resize(n);
+        mask = n - 1;
+    }
+
+    inline size_t capacity() const { return slots.size(); }
+
+    inline size_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    // Producer: false if the ring is full
+    inline bool push(const T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+
+        if ( h - tail.load(std::memory_order_acquire) > mask )
+            return false;
+        slots[h & mask] = item;
+        head.store(h + 1,std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: false if the ring is empty
+    inline bool pop(T& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+
+        if ( t == head.load(std::memory_order_acquire) )
+            return false;
+        item = slots[t & mask];
+        tail.store(t + 1,std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: Pop up to max items, returning the count
+    size_t pop(T *items,size_t max) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t n = head.load(std::memory_order_acquire) - t;
+
+        if ( n > max )
+            n = max;
+        for ( size_t x = 0; x < n; ++x )
+            items[x] = slots[(t + x) & mask];
+        tail.store(t + n,std::memory_order_release);
+        return n;
+    }
+};
+
+#endif // SPSCRING_HPP
+
+// End spscring.hpp
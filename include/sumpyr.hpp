@@ -0,0 +1,74 @@
+///////////////////////////////////////////////////////////////////////
+// sumpyr.hpp -- Multi-Resolution Summary Pyramid of a Capture
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#ifndef SUMPYR_HPP
+#define SUMPYR_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <vector>
+
+#define SUMPYR_CHANNELS     32      // One per GPLEV0 bit
+#define SUMPYR_FANOUT       16      // Each level is 16x coarser
+#define SUMPYR_BASE         256     // Default samples per level 0 bucket
+
+class SummaryPyramid {
+public:
+    struct s_summary {
+        uint32_t    or_bits;        // Channels high at some sample
+        uint32_t    and_bits;       // Channels high at every sample
+        uint32_t    edges[SUMPYR_CHANNELS]; // Transitions per channel
+    };
+
+private:
+    struct s_level {
+        uint64_t    bucket;         // Samples per bucket
+        std::vector<uint32_t> ors;  // OR of levels, per bucket
+        std::vector<uint32_t> ands; // AND of levels, per bucket
+        std::vector<uint32_t> edges; // SUMPYR_CHANNELS counts per bucket
+    };
+
+    std::vector<s_level> levels;    // levels[0] is the finest
+    unsigned    base;               // Samples per level 0 bucket
+    uint64_t    n_samples;          // Samples summarized
+    uint32_t    initial;            // Levels of sample 0
+    uint32_t    prev;               // Last sample fed
+    s_summary   cur;                // Level 0 bucket being filled
+    unsigned    cur_n;              // Samples in cur
+    bool        done;               // finish() called
+
+    void flush();                   // Append cur to level 0
+    void accumulate(s_summary& sum,const s_level& lev,size_t bx) const;
+
+public:
+    SummaryPyramid(unsigned base=SUMPYR_BASE);
+
+    void clear();
+    void feed(const uint32_t *samples,size_t n); // Stream blocks in order
+    void finish();                  // Build the coarser levels
+
+    inline uint64_t get_samples() const { return n_samples; }
+    inline uint32_t get_initial() const { return initial; }
+    inline unsigned get_levels() const { return levels.size(); }
+    inline uint64_t bucket_samples(unsigned level) const { return levels[level].bucket; }
+    inline size_t buckets(unsigned level) const { return levels[level].ors.size(); }
+
+    void bucket(unsigned level,size_t bx,s_summary& sum) const;
+
+    // Summarize [from,to) as columns, each rounded outward to buckets
+    // of the coarsest level no wider than a column
+    void render(uint64_t from,uint64_t to,unsigned columns,std::vector<s_summary>& out) const;
+
+    int save(const char *path) const;   // Returns 0 or errno
+    int load(const char *path);         // Returns 0 or errno
+};
+
+#endif // SUMPYR_HPP
+
+// End sumpyr.hpp
@@ -41,6 +41,7 @@ public:
     bool open(const char *path,double n,const char *units,const char *vers);
     void close();
     void define_binary(int ref,const char *name);
+    void comment(const char *text);
 
     void set_time(unsigned t);
     void set_value(int ref,bool value);
@@ -0,0 +1,84 @@
+//////////////////////////////////////////////////////////////////////
+// waveform.hpp -- DMA paced GPIO waveform engine
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#ifndef WAVEFORM_HPP
+#define WAVEFORM_HPP
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "dma.hpp"
+#include "pacer.hpp"
+
+#define WAVE_CHAN           13      // DMA channel (logana paces with 14)
+#define WAVE_MAX_STEPS      1024    // Default steps per waveform
+#define WAVE_PACE_TICKS     16383   // Ticks per pacing CB (Lite TXFR_LEN)
+
+class Waveform {
+public:
+    struct s_step {
+        uint32_t    tick;           // Ticks from the start of the period
+        uint32_t    set;            // GPIO 0-31 to set (GPSET0)
+        uint32_t    clear;          // GPIO 0-31 to clear first (GPCLR0)
+    };
+
+private:
+    struct s_chain {
+        DMA::CB     *cbs;           // Looping CB chain
+        uint32_t    *data;          // Masks, then the dummy pacing word
+        uint32_t    cb_bus;         // Bus address of cbs[0]
+        uint32_t    data_bus;       // Bus address of data[0]
+        unsigned    n_cbs;          // CBs in use
+    };
+
+    DMA         *dma;               // Channel, and DmaMem allocations
+    Pacer       *pacer;             // PWM timebase (PWM pacing only)
+    s_chain     chains[2];          // Double buffered waveforms
+    unsigned    active;             // Chain the DMA is running
+    bool        running;            // DMA started
+    bool        pending;            // Swap to !active requested
+    unsigned    max_steps;          // Steps per chain
+    unsigned    max_cbs;            // CBs per chain
+    int         channel;            // DMA channel
+    unsigned    pace_dreq;          // DREQ pacing the chain
+    uint32_t    pace_addr;          // FIFO written by pacing CBs
+    double      rate;               // Ticks per second
+    std::string errmsg;             // Error message
+
+    bool compile(s_chain& chain,const std::vector<s_step>& steps,uint32_t period);
+
+public:
+    Waveform(unsigned max_steps=WAVE_MAX_STEPS);
+    ~Waveform();
+
+    inline const char *error() { return errmsg.c_str(); }
+    inline void set_channel(int ch) { channel = ch; }
+
+    // Pace with another DREQ/FIFO (e.g. PCM TX: DREQ_2, 0x7E203004),
+    // that the caller runs at tick_hz: The Pacer is then not used
+    inline void set_pacing(unsigned dreq,uint32_t fifo_addr) { pace_dreq = dreq; pace_addr = fifo_addr; }
+
+    bool open(double tick_hz);      // DMA channel, memory and pacer
+    void close();
+
+    inline double get_rate() { return rate; }
+    inline uint32_t ticks(double us) { return uint32_t(us * rate / 1e6 + 0.5); }
+
+    // Run steps every period ticks: If a waveform is already running,
+    // the new one takes over when the current period ends
+    bool load(const std::vector<s_step>& steps,uint32_t period);
+    bool swapped();                 // True when the last load() is running
+    bool wait_swap(unsigned timeout_ms);
+    void stop();
+};
+
+#endif // WAVEFORM_HPP
+
+// End waveform.hpp
@@ -21,6 +21,14 @@
 #include <linux/interrupt.h>
 #include <linux/poll.h>
 #include <linux/sched.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+#include <linux/mm.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <asm/io.h>
 
 #include <linux/module.h>
@@ -40,6 +48,33 @@ struct s_dmares {
     unsigned            n_sg;       /* # items in sg_list */
     struct dma_async_tx_descriptor *tx_desc; /* DMA tx descriptor */
     dma_cookie_t        cookie;     /* Cookie for submission */
+    int                 mode;       /* Prepared: RPIDMA_START/_CYCLIC or 0 */
+    dma_addr_t          cyc_buf;    /* Cyclic ring bus address */
+    size_t              cyc_len;    /* Cyclic ring length */
+    size_t              cyc_period; /* Cyclic period length */
+    int                 cyclic;     /* True when running cyclic */
+    spinlock_t          lock;       /* Protects period counters */
+    wait_queue_head_t   wq;         /* read()/poll() waiters */
+    unsigned            n_periods;  /* # of periods in cyclic ring */
+    unsigned            cyc_at;     /* Period the DMA was last seen in */
+    ktime_t             cyc_seen;   /* When cyc_at was sampled */
+    int                 residue_ok; /* Channel reports a usable residue */
+    uint32_t            periods;    /* Periods completed by DMA */
+    uint32_t            consumed;   /* Periods consumed by read() */
+    uint32_t            overruns;   /* Periods lost to overrun */
+    struct device       *buf_dev;   /* Device owning buffer ring */
+    void                *buf_virt;  /* Buffer ring (kernel virtual) */
+    dma_addr_t          buf_bus;    /* Buffer ring bus address */
+    uint32_t            n_bufs;     /* # of buffers in ring */
+    uint32_t            buf_sz;     /* Bytes per buffer */
+    atomic_t            n_maps;     /* # of user mappings of ring */
+    uint32_t            sg_bytes;   /* Bytes in prepared sg transfer */
+    ktime_t             t_submit;   /* When the transfer was submitted */
+    ktime_t             t_done;     /* When it completed */
+    int                 timed;      /* True when t_done is valid */
+    int                 first_seen; /* First byte time was counted */
+    int                 errored;    /* DMA error was counted */
+    struct s_rpidma_stats stats;    /* Counters for this file */
 };
 
 static struct s_rpidma {
@@ -50,17 +85,40 @@ static struct s_rpidma {
 static int rpidma_open(struct inode *,struct file *);
 static int rpidma_release(struct inode *,struct file *);
 static long rpidma_ioctl(struct file *,unsigned cmd,unsigned long arg);
+static ssize_t rpidma_read(struct file *,char __user *,size_t,loff_t *);
+static unsigned int rpidma_poll(struct file *,poll_table *);
+static int rpidma_mmap(struct file *,struct vm_area_struct *);
+static void rpidma_stop(struct s_dmares *);
+static void rpidma_free_bufs(struct s_dmares *);
 
 static const struct file_operations rpidma_fops = {
     .owner = THIS_MODULE,
     .open = rpidma_open,
     .release = rpidma_release,
     .unlocked_ioctl = rpidma_ioctl,
+    .read = rpidma_read,
+    .poll = rpidma_poll,
+    .mmap = rpidma_mmap,
 };
 
 static struct class *rpidma_class;
 static dev_t rpidma_dev_no;
 
+static struct s_rpidma_stats rpidma_gstats; /* Counters for all files */
+static DEFINE_SPINLOCK(rpidma_gstats_lock);
+static atomic_t rpidma_n_open;              /* Files open */
+static struct dentry *rpidma_debugfs;       /* debugfs directory */
+
+static int rpidma_debugfs_open(struct inode *,struct file *);
+
+static const struct file_operations rpidma_stats_fops = {
+    .owner = THIS_MODULE,
+    .open = rpidma_debugfs_open,
+    .read = seq_read,
+    .llseek = seq_lseek,
+    .release = single_release,
+};
+
 /*
  * Module startup:
  */
@@ -88,6 +146,12 @@ rpidma_start(void) {
     }
 
     device_create(rpidma_class,NULL,rpidma_dev_no,&rpidma_dev.cdev,"%s",rpidma_dev.name);
+
+    /* Optional: /sys/kernel/debug/rpidma4x/stats */
+    rpidma_debugfs = debugfs_create_dir(DEVICE_NAME,NULL);
+    if ( !IS_ERR_OR_NULL(rpidma_debugfs) )
+        debugfs_create_file("stats",S_IRUGO,rpidma_debugfs,NULL,&rpidma_stats_fops);
+
     printk(KERN_INFO "Module rpidma4x loaded.\n");
     return 0;
 }
@@ -98,6 +162,7 @@ rpidma_start(void) {
 static void __exit
 rpidma_end(void) {
 
+    debugfs_remove_recursive(rpidma_debugfs);
     unregister_chrdev_region(rpidma_dev_no,1);
     device_destroy(rpidma_class,MKDEV(MAJOR(rpidma_dev_no),0));
     cdev_del(&rpidma_dev.cdev);
@@ -122,6 +187,27 @@ rpidma_open(struct inode *inode,struct file *file) {
     res->n_sg = 0;
     res->tx_desc = 0;
     res->cookie = 0;
+    res->mode = 0;
+    res->cyc_buf = 0;
+    res->cyc_len = res->cyc_period = 0;
+    res->cyclic = 0;
+    spin_lock_init(&res->lock);
+    init_waitqueue_head(&res->wq);
+    res->n_periods = res->cyc_at = 0;
+    res->residue_ok = 0;
+    res->periods = res->consumed = res->overruns = 0;
+    res->buf_dev = 0;
+    res->buf_virt = 0;
+    res->buf_bus = 0;
+    res->n_bufs = res->buf_sz = 0;
+    atomic_set(&res->n_maps,0);
+    res->sg_bytes = 0;
+    res->t_submit = res->t_done = ktime_set(0,0);
+    res->cyc_seen = ktime_set(0,0);
+    res->timed = 0;
+    res->first_seen = res->errored = 0;
+    memset(&res->stats,0,sizeof res->stats);
+    atomic_inc(&rpidma_n_open);
 
     devp = container_of(inode->i_cdev,struct s_rpidma,cdev);
     file->private_data = res;
@@ -136,118 +222,735 @@ rpidma_release(struct inode *inode,struct file *file) {
     struct s_dmares *res = (struct s_dmares *)file->private_data;
 
     if ( res ) {
-        if ( res->dma_chan ) {
-            dmaengine_terminate_all(res->dma_chan);
-            dma_release_channel(res->dma_chan);
-            res->dma_chan = 0;
-	}
+        rpidma_stop(res);
+        rpidma_free_bufs(res);
+        if ( res->buf_dev )
+            put_device(res->buf_dev);
         if ( res->sg_list ) {
             kfree(res->sg_list);
             res->sg_list = 0;
             res->n_sg = 0;
         }
         kfree(res);
+        atomic_dec(&rpidma_n_open);
     }
 
     return 0;
 }
 
 /*
- * ioctl(2) Commands:
+ * Stop the transfer (if any), but retain the channel, waking any
+ * cyclic readers. Waits for callbacks still queued in the DMA
+ * tasklet, so that res may then be reset or freed:
  */
-static long
-rpidma_ioctl(
-  struct file *file,
-  unsigned cmd,
-  unsigned long arg) {
-    struct s_dmares *res = (struct s_dmares *)file->private_data;
-    struct s_rpidma_ioctl sarg;
+static void
+rpidma_halt(struct s_dmares *res) {
+
+    if ( res->dma_chan )
+        dmaengine_terminate_sync(res->dma_chan);
+    if ( res->cyclic ) {
+        res->cyclic = 0;
+        wake_up_interruptible(&res->wq);
+    }
+}
+
+/*
+ * Stop the transfer and release the channel (if any):
+ */
+static void
+rpidma_stop(struct s_dmares *res) {
+
+    rpidma_halt(res);
+    if ( res->dma_chan ) {
+        dma_release_channel(res->dma_chan);
+        res->dma_chan = 0;
+    }
+    res->mode = 0;
+}
+
+/*
+ * Configure a channel for dev_addr => memory (or memory => dev_addr
+ * for RPIDMA_MEM_TO_DEV), paced by DREQ slave_id (0 for none). A
+ * channel already held is reused, so that re-arming avoids
+ * dma_request_channel():
+ */
+static int
+rpidma_chan_setup(struct s_dmares *res,uint32_t dev_addr,uint32_t slave_id,uint32_t direction) {
+    struct dma_slave_caps caps;
     dma_cap_mask_t mask;
-    enum dma_status dma_status;
-    struct scatterlist *sglist, *sgent;
-    uint32_t *usr_ptr = 0;
-    int rc, x;
+    int rc;
 
-    switch ( cmd ) {
-    case RPIDMA_START:
-        if ( copy_from_user(&sarg,(char *)arg,sizeof sarg) )
-            return -EFAULT;
+    if ( direction != RPIDMA_DEV_TO_MEM && direction != RPIDMA_MEM_TO_DEV )
+        return -EINVAL;
 
-        if ( res->dma_chan ) {
-            /* Release existing channel */
-            dmaengine_terminate_all(res->dma_chan);
-            dma_release_channel(res->dma_chan);
-            res->dma_chan = 0;
-        }
+    rpidma_halt(res);
+    res->mode = 0;
 
+    if ( direction == RPIDMA_MEM_TO_DEV ) {
+        res->config.direction = DMA_MEM_TO_DEV;
+        res->config.src_addr = 0;
+        res->config.dst_addr = dev_addr;
+    } else {
         res->config.direction = DMA_DEV_TO_MEM;
-        res->config.src_addr = sarg.src_addr;
+        res->config.src_addr = dev_addr;
         res->config.dst_addr = 0;
-        res->config.src_addr_width = 4;
-        res->config.dst_addr_width = 4;
-        res->config.src_maxburst = 1;
-        res->config.dst_maxburst = 1;
-        res->config.device_fc = 0;
-        res->config.slave_id = 0;           /* No DREQ */
+    }
+    res->config.src_addr_width = 4;
+    res->config.dst_addr_width = 4;
+    res->config.src_maxburst = 1;
+    res->config.dst_maxburst = 1;
+    res->config.device_fc = 0;
+    res->config.slave_id = slave_id;    /* DREQ (0 is none) */
 
-	dma_cap_zero(mask);
-	res->dma_chan = dma_request_channel(mask,0,0);
+    if ( !res->dma_chan ) {
+        dma_cap_zero(mask);
+        res->dma_chan = dma_request_channel(mask,0,0);
 
         if ( !res->dma_chan )
             return -EBUSY;
+    }
 
-        rc = dmaengine_slave_config(res->dma_chan,&res->config);
-        if ( rc < 0 )
-            return -rc;
+    rc = dmaengine_slave_config(res->dma_chan,&res->config);
+    if ( rc < 0 )
+        return rc;
 
-        /* Access list of user mode buffers */
-        usr_ptr = kmalloc(sarg.n_dst * sizeof(uint32_t),GFP_KERNEL);
-        if ( copy_from_user(usr_ptr,(char *)sarg.pdst_addr,sarg.n_dst * sizeof(uint32_t)) )
-            return -EFAULT;
+    res->residue_ok = !dma_get_slave_caps(res->dma_chan,&caps)
+        && caps.residue_granularity != DMA_RESIDUE_GRANULARITY_DESCRIPTOR;
+    return 0;
+}
+
+/*
+ * Fetch the destination list: from user space, or when n_dst is
+ * zero, the driver's buffer ring (updating n_dst and page_sz):
+ */
+static int
+rpidma_dsts(struct s_dmares *res,struct s_rpidma_ioctl *sarg,uint32_t **dsts) {
+    int use_ring = !sarg->n_dst;
+    uint32_t *list;
+    unsigned x;
+
+    if ( use_ring ) {
+        if ( !res->buf_virt )
+            return -EINVAL;             /* No RPIDMA_ALLOC ring */
+        sarg->n_dst = res->n_bufs;
+        sarg->page_sz = res->buf_sz;
+    }
+
+    list = kmalloc(sarg->n_dst * sizeof(uint32_t),GFP_KERNEL);
+    if ( !list )
+        return -ENOMEM;
+
+    if ( use_ring ) {
+        for ( x = 0; x < sarg->n_dst; ++x )
+            list[x] = res->buf_bus + x * sarg->page_sz;
+    } else if ( copy_from_user(list,(char *)sarg->pdst_addr,sarg->n_dst * sizeof(uint32_t)) ) {
+        kfree(list);
+        return -EFAULT;
+    }
+
+    *dsts = list;
+    return 0;
+}
+
+/*
+ * Free the buffer ring (caller has stopped the DMA):
+ */
+static void
+rpidma_free_bufs(struct s_dmares *res) {
+
+    if ( res->buf_virt ) {
+        dma_free_coherent(res->buf_dev,res->n_bufs * res->buf_sz,res->buf_virt,res->buf_bus);
+        res->buf_virt = 0;
+        res->buf_bus = 0;
+        res->n_bufs = res->buf_sz = 0;
+    }
+}
+
+/*
+ * Allocate the buffer ring from the DMA controller's device:
+ */
+static int
+rpidma_alloc_bufs(struct s_dmares *res,struct s_rpidma_ring *ring) {
+    struct dma_chan *chan;
+    dma_cap_mask_t mask;
+
+    if ( atomic_read(&res->n_maps) > 0 )
+        return -EBUSY;                  /* Ring still mapped */
+
+    rpidma_stop(res);
+    rpidma_free_bufs(res);
 
-        /* Allocate a new scatter list */
+    ring->bus_addr = 0;
+    ring->size = 0;
+    if ( !ring->n_bufs )
+        return 0;                       /* Free only */
+
+    if ( !ring->buf_sz || (ring->buf_sz & (PAGE_SIZE-1)) )
+        return -EINVAL;
+    if ( ring->n_bufs > 0xFFFFFFFFu / ring->buf_sz )
+        return -EINVAL;
+
+    if ( !res->buf_dev ) {
+        dma_cap_zero(mask);
+        chan = dma_request_channel(mask,0,0);
+        if ( !chan )
+            return -EBUSY;
+        res->buf_dev = get_device(chan->device->dev);
+        dma_release_channel(chan);
+    }
+
+    res->buf_virt = dma_alloc_coherent(res->buf_dev,ring->n_bufs * ring->buf_sz,&res->buf_bus,GFP_KERNEL);
+    if ( !res->buf_virt )
+        return -ENOMEM;
+
+    res->n_bufs = ring->n_bufs;
+    res->buf_sz = ring->buf_sz;
+    ring->bus_addr = res->buf_bus;
+    ring->size = res->n_bufs * res->buf_sz;
+    return 0;
+}
+
+static void
+rpidma_vm_open(struct vm_area_struct *vma) {
+    struct s_dmares *res = (struct s_dmares *)vma->vm_private_data;
+
+    atomic_inc(&res->n_maps);
+}
+
+static void
+rpidma_vm_close(struct vm_area_struct *vma) {
+    struct s_dmares *res = (struct s_dmares *)vma->vm_private_data;
+
+    atomic_dec(&res->n_maps);
+}
+
+static const struct vm_operations_struct rpidma_vm_ops = {
+    .open = rpidma_vm_open,
+    .close = rpidma_vm_close,
+};
+
+/*
+ * mmap(2): Map the buffer ring into user space:
+ */
+static int
+rpidma_mmap(struct file *file,struct vm_area_struct *vma) {
+    struct s_dmares *res = (struct s_dmares *)file->private_data;
+    unsigned long len = vma->vm_end - vma->vm_start;
+    size_t size = res->n_bufs * res->buf_sz;
+    int rc;
+
+    if ( !res->buf_virt )
+        return -ENXIO;
+    if ( (vma->vm_pgoff << PAGE_SHIFT) + len > size )
+        return -EINVAL;
+
+    rc = dma_mmap_coherent(res->buf_dev,vma,res->buf_virt,res->buf_bus,size);
+    if ( rc )
+        return rc;
+
+    vma->vm_ops = &rpidma_vm_ops;
+    vma->vm_private_data = res;
+    rpidma_vm_open(vma);
+    return 0;
+}
+
+/*
+ * Histogram bucket for a latency of us microseconds:
+ */
+static unsigned
+rpidma_bucket(s64 us) {
+    unsigned x;
+
+    if ( us < 2 )
+        return 0;
+    x = ilog2((u64)us);
+    return x < RPIDMA_HIST_BUCKETS ? x : RPIDMA_HIST_BUCKETS - 1;
+}
+
+/*
+ * Add one event to a set of counters. Latencies < 0 are not counted:
+ */
+static void
+rpidma_stats_add(struct s_rpidma_stats *st,unsigned submits,unsigned completions,
+  unsigned periods,unsigned errors,uint32_t bytes,s64 first_us,s64 done_us) {
+
+    st->submits += submits;
+    st->completions += completions;
+    st->periods += periods;
+    st->errors += errors;
+    st->bytes += bytes;
+
+    if ( first_us >= 0 ) {
+        ++st->first_n;
+        st->first_sum_us += first_us;
+        if ( first_us > st->first_max_us )
+            st->first_max_us = first_us > 0xFFFFFFFFLL ? 0xFFFFFFFFu : (uint32_t)first_us;
+        ++st->first_hist[rpidma_bucket(first_us)];
+    }
+    if ( done_us >= 0 )
+        ++st->done_hist[rpidma_bucket(done_us)];
+}
+
+/*
+ * Count an event for this file and globally (any context):
+ */
+static void
+rpidma_account(struct s_dmares *res,unsigned submits,unsigned completions,
+  unsigned periods,unsigned errors,uint32_t bytes,s64 first_us,s64 done_us) {
+    unsigned long flags;
+
+    spin_lock_irqsave(&res->lock,flags);
+    rpidma_stats_add(&res->stats,submits,completions,periods,errors,bytes,first_us,done_us);
+    spin_unlock_irqrestore(&res->lock,flags);
+
+    spin_lock_irqsave(&rpidma_gstats_lock,flags);
+    rpidma_stats_add(&rpidma_gstats,submits,completions,periods,errors,bytes,first_us,done_us);
+    spin_unlock_irqrestore(&rpidma_gstats_lock,flags);
+}
+
+/*
+ * Microseconds since submission, the first time progress is seen
+ * (else -1). Called with res->lock held:
+ */
+static s64
+rpidma_first_us(struct s_dmares *res) {
+
+    if ( res->first_seen )
+        return -1;
+    res->first_seen = 1;
+    return ktime_us_delta(ktime_get(),res->t_submit);
+}
+
+/*
+ * Periods completed since the last callback. The tasklet may merge
+ * several period completions into one callback, so they are found
+ * from the DMA's position in the ring (the residue): The period it is
+ * now filling, less the one it was last seen in, modulo the ring.
+ *
+ * No change of period is normally not a lap: When the callback for
+ * period k runs late, after k+1 has completed, it counts both, and
+ * the callback for k+1 then sees no change. Counting a lap there
+ * would report a ring of lost periods on a gap-free stream. So no
+ * change counts as a lap only when at least half a lap's time (at
+ * the rate measured so far) has passed since the last sample, or
+ * when nothing has been counted yet. Called with res->lock held:
+ */
+static unsigned
+rpidma_periods_done(struct s_dmares *res) {
+    struct dma_tx_state tx_state;
+    ktime_t now = ktime_get();
+    unsigned at, done;
+    u64 since, period_ns;
+
+    if ( !res->residue_ok )
+        return 1;                       /* One per callback */
+
+    if ( dmaengine_tx_status(res->dma_chan,res->cookie,&tx_state) == DMA_ERROR
+      || tx_state.residue > res->cyc_len )
+        return 1;
+
+    at = (res->cyc_len - tx_state.residue) / res->cyc_period % res->n_periods;
+    done = (at + res->n_periods - res->cyc_at) % res->n_periods;
+
+    if ( !done ) {
+        if ( !res->periods ) {
+            done = res->n_periods;      /* Nothing counted ahead */
+        } else {
+            since = ktime_to_ns(ktime_sub(now,res->cyc_seen));
+            period_ns = div64_u64(ktime_to_ns(ktime_sub(now,res->t_submit)),res->periods);
+            if ( since * 2 >= (u64)res->n_periods * period_ns )
+                done = res->n_periods;  /* A lap went unseen */
+        }
+    }
+
+    res->cyc_at = at;
+    res->cyc_seen = now;
+    return done;
+}
+
+/*
+ * Cyclic period completion (called from DMA tasklet):
+ */
+static void
+rpidma_period(void *arg) {
+    struct s_dmares *res = (struct s_dmares *)arg;
+    unsigned long flags;
+    unsigned done;
+    s64 first_us;
+
+    spin_lock_irqsave(&res->lock,flags);
+    done = rpidma_periods_done(res);
+    res->periods += done;
+    first_us = rpidma_first_us(res);
+    spin_unlock_irqrestore(&res->lock,flags);
+
+    rpidma_account(res,0,0,done,0,done * res->cyc_period,first_us,-1);
+    wake_up_interruptible(&res->wq);
+}
+
+/*
+ * Scatter/gather completion (called from DMA tasklet):
+ */
+static void
+rpidma_done(void *arg) {
+    struct s_dmares *res = (struct s_dmares *)arg;
+    unsigned long flags;
+    s64 done_us;
+
+    spin_lock_irqsave(&res->lock,flags);
+    res->t_done = ktime_get();
+    res->timed = 1;
+    done_us = ktime_us_delta(res->t_done,res->t_submit);
+    spin_unlock_irqrestore(&res->lock,flags);
+
+    rpidma_account(res,0,1,0,0,res->sg_bytes,-1,done_us);
+}
+
+/*
+ * Return non-zero if a period is waiting for read():
+ */
+static int
+rpidma_pending(struct s_dmares *res) {
+    unsigned long flags;
+    int pending;
+
+    spin_lock_irqsave(&res->lock,flags);
+    pending = res->periods != res->consumed;
+    spin_unlock_irqrestore(&res->lock,flags);
+    return pending;
+}
+
+/*
+ * read(2): Return the next completed cyclic period. When the DMA
+ * has lapped the reader, the overwritten periods are skipped and
+ * counted as overruns. Returns 0 (EOF) once cyclic DMA is cancelled.
+ */
+static ssize_t
+rpidma_read(struct file *file,char __user *buf,size_t count,loff_t *ppos) {
+    struct s_dmares *res = (struct s_dmares *)file->private_data;
+    struct s_rpidma_period per;
+    uint32_t pending, lost;
+    unsigned long flags;
+
+    if ( count < sizeof per )
+        return -EINVAL;
+
+    if ( !rpidma_pending(res) ) {
+        if ( !res->cyclic )
+            return 0;
+        if ( file->f_flags & O_NONBLOCK )
+            return -EAGAIN;
+        if ( wait_event_interruptible(res->wq,rpidma_pending(res) || !res->cyclic) )
+            return -ERESTARTSYS;
+    }
+
+    spin_lock_irqsave(&res->lock,flags);
+    pending = res->periods - res->consumed;
+    if ( !pending ) {
+        spin_unlock_irqrestore(&res->lock,flags);
+        return 0;                       /* Cancelled */
+    }
+    if ( pending >= res->n_periods ) {
+        /* Only the last n_periods-1 periods are intact */
+        lost = pending - (res->n_periods - 1);
+        res->consumed += lost;
+        res->overruns += lost;
+    }
+    per.period = res->consumed;
+    per.index = res->consumed % res->n_periods;
+    per.overruns = res->overruns;
+    ++res->consumed;
+    spin_unlock_irqrestore(&res->lock,flags);
+
+    if ( copy_to_user(buf,&per,sizeof per) )
+        return -EFAULT;
+    return sizeof per;
+}
+
+/*
+ * poll(2): Readable when a cyclic period has completed:
+ */
+static unsigned int
+rpidma_poll(struct file *file,poll_table *wait) {
+    struct s_dmares *res = (struct s_dmares *)file->private_data;
+
+    poll_wait(file,&res->wq,wait);
+
+    if ( rpidma_pending(res) || !res->cyclic )
+        return POLLIN | POLLRDNORM;
+    return 0;
+}
+
+/*
+ * Prepare a scatter/gather transfer into (or out of) n_dst buffers of
+ * page_sz:
+ */
+static int
+rpidma_prep_sg(struct s_dmares *res,struct s_rpidma_ioctl *sarg) {
+    struct scatterlist *sglist, *sgent;
+    uint32_t *usr_ptr = 0;
+    int rc, x;
+
+    /* Access list of user mode buffers (or buffer ring) */
+    rc = rpidma_dsts(res,sarg,&usr_ptr);
+    if ( rc )
+        return rc;
+
+    rc = rpidma_chan_setup(res,sarg->src_addr,sarg->slave_id,sarg->direction);
+    if ( rc ) {
+        kfree(usr_ptr);
+        return rc;
+    }
+
+    /* Allocate a new scatter list, unless the size is unchanged */
+    if ( !res->sg_list || res->n_sg != sarg->n_dst ) {
         if ( res->sg_list )
             kfree(res->sg_list);
 
-        res->n_sg = sarg.n_dst;
+        res->n_sg = sarg->n_dst;
         res->sg_list = kmalloc(res->n_sg * sizeof(struct scatterlist),GFP_KERNEL);
-        sg_init_table(res->sg_list,res->n_sg);
+        if ( !res->sg_list ) {
+            res->n_sg = 0;
+            kfree(usr_ptr);
+            return -ENOMEM;
+        }
+    }
+    sg_init_table(res->sg_list,res->n_sg);
+
+    sglist = res->sg_list;
+    for_each_sg(sglist,sgent,res->n_sg,x) {
+        // Cheat since we can't provide a proper input mapping
+        // (unless these are from our own buffer ring)
+        sg_dma_address(sgent) = usr_ptr[x];
+        sg_dma_len(sgent) = sarg->page_sz;
+    }
+
+    kfree(usr_ptr);
+    res->sg_bytes = res->n_sg * sarg->page_sz;
+    res->mode = RPIDMA_START;
+    return 0;
+}
+
+/*
+ * Prepare a cyclic transfer over a contiguous ring of n_dst periods:
+ */
+static int
+rpidma_prep_cyclic(struct s_dmares *res,struct s_rpidma_ioctl *sarg) {
+    uint32_t *usr_ptr = 0;
+    unsigned x;
+    int rc;
 
-        sglist = res->sg_list;
-        for_each_sg(sglist,sgent,res->n_sg,x) {
-            // Cheat since we can't provide a proper input mapping
-            sg_dma_address(sgent) = usr_ptr[x];
-            sg_dma_len(sgent) = sarg.page_sz;
+    rc = rpidma_dsts(res,sarg,&usr_ptr);
+    if ( rc )
+        return rc;
+
+    if ( sarg->n_dst < 2 || !sarg->page_sz ) {
+        kfree(usr_ptr);
+        return -EINVAL;                 /* Need a ring of 2+ periods */
+    }
+
+    /* The ring must be one contiguous buffer of n_dst periods */
+    for ( x = 1; x < sarg->n_dst; ++x ) {
+        if ( usr_ptr[x] != usr_ptr[0] + x * sarg->page_sz ) {
+            kfree(usr_ptr);
+            return -EINVAL;
         }
+    }
 
+    rc = rpidma_chan_setup(res,sarg->src_addr,sarg->slave_id,sarg->direction);
+    if ( rc ) {
         kfree(usr_ptr);
-        usr_ptr = 0;
+        return rc;
+    }
 
-        res->tx_desc = dmaengine_prep_slave_sg(res->dma_chan,res->sg_list,res->n_sg,DMA_DEV_TO_MEM,0);
-        res->cookie = dmaengine_submit(res->tx_desc);
+    res->n_periods = sarg->n_dst;
+    res->cyc_buf = usr_ptr[0];
+    res->cyc_len = sarg->n_dst * sarg->page_sz;
+    res->cyc_period = sarg->page_sz;
+    kfree(usr_ptr);
 
-        dma_async_issue_pending(res->dma_chan);
-        return 0;
+    res->mode = RPIDMA_CYCLIC;
+    return 0;
+}
+
+/*
+ * Submit the prepared transfer on the held channel. The descriptor is
+ * re-prepared from the retained scatterlist (or ring) each time, since
+ * the descriptor is consumed by its completion:
+ */
+static int
+rpidma_submit(struct s_dmares *res) {
+    unsigned long flags;
+
+    if ( !res->dma_chan || !res->mode )
+        return -ENOENT;                 /* Nothing prepared */
+
+    if ( res->mode == RPIDMA_CYCLIC ) {
+        res->tx_desc = dmaengine_prep_dma_cyclic(res->dma_chan,
+            res->cyc_buf,
+            res->cyc_len,
+            res->cyc_period,
+            res->config.direction,
+            DMA_PREP_INTERRUPT);
+        if ( !res->tx_desc ) {
+            rpidma_account(res,0,0,0,1,0,-1,-1);
+            return -ENOMEM;
+        }
+
+        res->tx_desc->callback = rpidma_period;
+        res->tx_desc->callback_param = res;
+        res->periods = res->consumed = res->overruns = 0;
+        res->cyc_at = 0;
+        res->cyclic = 1;
+    } else {
+        res->tx_desc = dmaengine_prep_slave_sg(res->dma_chan,res->sg_list,res->n_sg,
+            res->config.direction,DMA_PREP_INTERRUPT);
+        if ( !res->tx_desc ) {
+            rpidma_account(res,0,0,0,1,0,-1,-1);
+            return -ENOMEM;
+        }
+
+        res->tx_desc->callback = rpidma_done;
+        res->tx_desc->callback_param = res;
+    }
+
+    spin_lock_irqsave(&res->lock,flags);
+    res->timed = 0;
+    res->first_seen = res->errored = 0;
+    res->t_submit = res->cyc_seen = ktime_get();
+    spin_unlock_irqrestore(&res->lock,flags);
+
+    res->cookie = dmaengine_submit(res->tx_desc);
+    dma_async_issue_pending(res->dma_chan);
+    rpidma_account(res,1,0,0,0,0,-1,-1);
+    return 0;
+}
+
+/*
+ * ioctl(2) Commands:
+ */
+static long
+rpidma_ioctl(
+  struct file *file,
+  unsigned cmd,
+  unsigned long arg) {
+    struct s_dmares *res = (struct s_dmares *)file->private_data;
+    struct s_rpidma_ioctl sarg;
+    struct s_rpidma_ring ring;
+    struct s_rpidma_timing timing;
+    struct s_rpidma_stats stats;
+    struct dma_tx_state tx_state;
+    enum dma_status dma_status;
+    unsigned long flags;
+    s64 elapsed, first_us;
+    int rc;
+
+    switch ( cmd ) {
+    case RPIDMA_START:
+    case RPIDMA_PREPARE:
+        if ( copy_from_user(&sarg,(char *)arg,sizeof sarg) )
+            return -EFAULT;
+
+        rc = rpidma_prep_sg(res,&sarg);
+        if ( rc || cmd == RPIDMA_PREPARE )
+            return rc;                  /* Else start it */
+        return rpidma_submit(res);
+
+    case RPIDMA_CYCLIC:
+        if ( copy_from_user(&sarg,(char *)arg,sizeof sarg) )
+            return -EFAULT;
+
+        rc = rpidma_prep_cyclic(res,&sarg);
+        if ( rc )
+            return rc;
+        return rpidma_submit(res);
+
+    case RPIDMA_RESTART:
+        rpidma_halt(res);               /* Stop current, keep channel */
+        return rpidma_submit(res);
 
     case RPIDMA_STATUS:
         if ( !res->dma_chan )
             return -ENOENT;
 
-        dma_status = dma_async_is_tx_complete(res->dma_chan,res->cookie,0,0);
-        if ( dma_status == DMA_ERROR )
+        dma_status = dmaengine_tx_status(res->dma_chan,res->cookie,&tx_state);
+        if ( dma_status == DMA_ERROR ) {
+            spin_lock_irqsave(&res->lock,flags);
+            rc = !res->errored;
+            res->errored = 1;
+            spin_unlock_irqrestore(&res->lock,flags);
+
+            if ( rc )
+                rpidma_account(res,0,0,0,1,0,-1,-1);
             return -EIO;
+        }
         
         if ( dma_status == DMA_COMPLETE )
             return 1;                   /* DMA has completed */
+
+        if ( res->mode == RPIDMA_START && tx_state.residue < res->sg_bytes ) {
+            /* Progress seen: time to first byte */
+            spin_lock_irqsave(&res->lock,flags);
+            first_us = rpidma_first_us(res);
+            spin_unlock_irqrestore(&res->lock,flags);
+
+            if ( first_us >= 0 )
+                rpidma_account(res,0,0,0,0,0,first_us,-1);
+        }
         return 0;                       /* DMA has not started / in progress */
 
+    case RPIDMA_ALLOC:
+        if ( copy_from_user(&ring,(char *)arg,sizeof ring) )
+            return -EFAULT;
+
+        rc = rpidma_alloc_bufs(res,&ring);
+        if ( rc )
+            return rc;
+
+        if ( copy_to_user((char *)arg,&ring,sizeof ring) )
+            return -EFAULT;
+        return 0;
+
+    case RPIDMA_TIMING:
+        spin_lock_irqsave(&res->lock,flags);
+        rc = res->timed;
+        elapsed = ktime_to_ns(ktime_sub(res->t_done,res->t_submit));
+        spin_unlock_irqrestore(&res->lock,flags);
+
+        if ( !rc )
+            return -EAGAIN;             /* Not (yet) completed */
+
+        timing.bytes = res->sg_bytes;
+        timing.elapsed_ns = elapsed > 0xFFFFFFFFLL ? 0xFFFFFFFFu : (uint32_t)elapsed;
+
+        if ( copy_to_user((char *)arg,&timing,sizeof timing) )
+            return -EFAULT;
+        return 0;
+
     case RPIDMA_CANCEL:
-        if ( res->dma_chan ) {
-            /* Release existing channel */
-            dmaengine_terminate_all(res->dma_chan);
-            dma_release_channel(res->dma_chan);
-            res->dma_chan = 0;
+        rpidma_halt(res);               /* Channel kept for RESTART */
+        return 0;
+
+    case RPIDMA_STATS:
+    case RPIDMA_GSTATS:
+        if ( cmd == RPIDMA_STATS ) {
+            spin_lock_irqsave(&res->lock,flags);
+            stats = res->stats;
+            spin_unlock_irqrestore(&res->lock,flags);
+        } else {
+            spin_lock_irqsave(&rpidma_gstats_lock,flags);
+            stats = rpidma_gstats;
+            spin_unlock_irqrestore(&rpidma_gstats_lock,flags);
         }
+
+        if ( copy_to_user((char *)arg,&stats,sizeof stats) )
+            return -EFAULT;
+        return 0;
+
+    case RPIDMA_CLRSTATS:
+        spin_lock_irqsave(&res->lock,flags);
+        memset(&res->stats,0,sizeof res->stats);
+        spin_unlock_irqrestore(&res->lock,flags);
         return 0;
 
     default :
@@ -257,6 +960,44 @@ rpidma_ioctl(
     return -EINVAL;
 }
 
+/*
+ * debugfs stats: The global counters, and non-empty histogram buckets
+ */
+static int
+rpidma_debugfs_show(struct seq_file *m,void *v) {
+    struct s_rpidma_stats st;
+    unsigned long flags;
+    unsigned x;
+
+    spin_lock_irqsave(&rpidma_gstats_lock,flags);
+    st = rpidma_gstats;
+    spin_unlock_irqrestore(&rpidma_gstats_lock,flags);
+
+    seq_printf(m,"open:        %d\n",atomic_read(&rpidma_n_open));
+    seq_printf(m,"submits:     %u\n",st.submits);
+    seq_printf(m,"completions: %u\n",st.completions);
+    seq_printf(m,"periods:     %u\n",st.periods);
+    seq_printf(m,"errors:      %u\n",st.errors);
+    seq_printf(m,"bytes:       %llu\n",(unsigned long long)st.bytes);
+    seq_printf(m,"first_n:     %u\n",st.first_n);
+    seq_printf(m,"first_max:   %u us\n",st.first_max_us);
+    seq_printf(m,"first_mean:  %llu us\n",
+        st.first_n ? (unsigned long long)div_u64(st.first_sum_us,st.first_n) : 0ULL);
+
+    seq_printf(m,"%-14s %10s %10s\n","usec >=","first","done");
+    for ( x = 0; x < RPIDMA_HIST_BUCKETS; ++x ) {
+        if ( st.first_hist[x] || st.done_hist[x] )
+            seq_printf(m,"%-14lu %10u %10u\n",
+                x ? 1UL << x : 0UL,st.first_hist[x],st.done_hist[x]);
+    }
+    return 0;
+}
+
+static int
+rpidma_debugfs_open(struct inode *inode,struct file *file) {
+    return single_open(file,rpidma_debugfs_show,NULL);
+}
+
 module_init(rpidma_start);
 module_exit(rpidma_end);
 
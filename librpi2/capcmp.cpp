@@ -0,0 +1,297 @@
+//////////////////////////////////////////////////////////////////////
+// capcmp.cpp -- Capture Alignment and Comparison Implementation
+//
+// After alignment, the two captures are XORed (masked) sample by
+// sample. A channel's mismatch window opens when its XOR bit sets
+// and closes when it clears. While no channel opens or closes, the
+// XOR equals the set of open windows, so runs of such samples are
+// skipped four at a time (NEON when available). Windows no longer
+// than the tolerance are edge timing differences and are dropped;
+// note this also hides genuine glitches as short as the tolerance.
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include <set>
+#include <algorithm>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define CAPCMP_NEON 1
+#endif
+
+#include "capcmp.hpp"
+
+#define CAPCMP_CANDIDATES   4096    // Most lags scored by correlate()
+#define CAPCMP_LEAD_EDGES   16      // Edges of a tried as anchors
+#define CAPCMP_SCORE_EDGES  64      // Edges of a spanned when scoring
+
+CaptureCompare::CaptureCompare() {
+    mask = ~0u;
+    tolerance = 0;
+    lag = 0;
+    first = compared = 0;
+}
+
+int64_t
+CaptureCompare::align_trigger(uint64_t trigger_a,uint64_t trigger_b) {
+    return int64_t(trigger_b) - int64_t(trigger_a);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Sample indexes where channel takes a new level
+//////////////////////////////////////////////////////////////////////
+
+static void
+channel_edges(const uint32_t *samples,size_t n,unsigned channel,std::vector<uint64_t>& edges) {
+    const uint32_t bit = 1u << channel;
+
+    edges.clear();
+    for ( size_t x = 1; x < n; ++x )
+        if ( (samples[x] ^ samples[x-1]) & bit )
+            edges.push_back(x);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Level of a channel at index, given its level at 0 and its edges
+//////////////////////////////////////////////////////////////////////
+
+static inline int
+level_at(int initial,const std::vector<uint64_t>& edges,uint64_t index) {
+    size_t n = std::upper_bound(edges.begin(),edges.end(),index) - edges.begin();
+
+    return initial ^ int(n & 1);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Count the samples in [lo,hi) (a's indexes) where a and the lagged
+// b differ, by merging their edge lists.
+//////////////////////////////////////////////////////////////////////
+
+static uint64_t
+mismatch_area(int a0,const std::vector<uint64_t>& ea,int b0,const std::vector<uint64_t>& eb,
+  int64_t lag,uint64_t lo,uint64_t hi) {
+    int la = level_at(a0,ea,lo);
+    int lb = level_at(b0,eb,uint64_t(int64_t(lo) + lag));
+    size_t ax = std::upper_bound(ea.begin(),ea.end(),lo) - ea.begin();
+    size_t bx = std::upper_bound(eb.begin(),eb.end(),uint64_t(int64_t(lo) + lag)) - eb.begin();
+    uint64_t at = lo, area = 0;
+
+    while ( at < hi ) {
+        uint64_t na = ax < ea.size() ? ea[ax] : hi;
+        uint64_t nb = bx < eb.size() ? uint64_t(int64_t(eb[bx]) - lag) : hi;
+        uint64_t next = std::min(std::min(na,nb),hi);
+
+        if ( la != lb )
+            area += next - at;
+        at = next;
+        if ( at >= hi )
+            break;
+        if ( na == at ) {
+            la ^= 1;
+            ++ax;
+        }
+        if ( nb == at ) {
+            lb ^= 1;
+            ++bx;
+        }
+    }
+    return area;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Binary cross-correlation of one channel: Each of the first edges
+// of a is paired with the like edges of b within max_lag, and each
+// candidate lag is scored by the fraction of samples that disagree
+// over the span of the first CAPCMP_SCORE_EDGES edges of a. The best
+// (then the smallest) lag wins. A periodic signal matches at every
+// period, so choose a channel with a distinctive pattern.
+//////////////////////////////////////////////////////////////////////
+
+bool
+CaptureCompare::correlate(const uint32_t *a,size_t na,const uint32_t *b,size_t nb,
+  unsigned channel,uint64_t max_lag,int64_t& lag) {
+    std::vector<uint64_t> ea, eb;
+    std::set<int64_t> candidates;
+
+    lag = 0;
+    if ( channel >= CAPCMP_CHANNELS || na < 2 || nb < 2 )
+        return false;
+
+    channel_edges(a,na,channel,ea);
+    channel_edges(b,nb,channel,eb);
+    if ( ea.empty() || eb.empty() )
+        return false;
+
+    const int a0 = (a[0] >> channel) & 1;
+    const int b0 = (b[0] >> channel) & 1;
+
+    for ( size_t ax = 0; ax < ea.size() && ax < CAPCMP_LEAD_EDGES; ++ax ) {
+        int rise_a = (a[ea[ax]] >> channel) & 1;
+        uint64_t lo = ea[ax] > max_lag ? ea[ax] - max_lag : 0;
+        size_t bx = std::lower_bound(eb.begin(),eb.end(),lo) - eb.begin();
+
+        for ( ; bx < eb.size() && eb[bx] <= ea[ax] + max_lag; ++bx ) {
+            if ( int((b[eb[bx]] >> channel) & 1) != rise_a )
+                continue;           // Rising only matches rising
+            candidates.insert(int64_t(eb[bx]) - int64_t(ea[ax]));
+            if ( candidates.size() >= CAPCMP_CANDIDATES )
+                break;
+        }
+    }
+
+    if ( candidates.empty() )
+        return false;
+
+    // Score over the span of a's leading edges
+    const uint64_t span = ea[std::min(ea.size(),size_t(CAPCMP_SCORE_EDGES))-1] + 1;
+    double best = 2.0;
+
+    for ( int64_t cand : candidates ) {
+        uint64_t lo = cand < 0 ? uint64_t(-cand) : 0;
+        uint64_t hi = std::min(uint64_t(na),uint64_t(int64_t(nb) - cand));
+
+        hi = std::min(hi,std::max(span,lo + span / 2));
+        if ( hi <= lo || hi - lo < span / 2 )
+            continue;               // Too little overlap to judge
+
+        double score = double(mismatch_area(a0,ea,b0,eb,cand,lo,hi)) / double(hi - lo);
+
+        if ( score < best || ( score == best && llabs(cand) < llabs(lag) ) ) {
+            best = score;
+            lag = cand;
+        }
+    }
+
+    return best <= 1.0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Skip samples whose masked XOR equals open (no window change)
+//////////////////////////////////////////////////////////////////////
+
+static size_t
+steady_length(const uint32_t *a,const uint32_t *b,size_t n,uint32_t mask,uint32_t open) {
+    size_t x = 0;
+
+#ifdef CAPCMP_NEON
+    uint32x4_t vmask = vdupq_n_u32(mask);
+    uint32x4_t vopen = vdupq_n_u32(open);
+
+    for ( ; x + 4 <= n; x += 4 ) {
+        uint32x4_t vx = vandq_u32(veorq_u32(vld1q_u32(a + x),vld1q_u32(b + x)),vmask);
+        uint32x4_t veq = vceqq_u32(vx,vopen);
+        uint32x2_t vmin = vpmin_u32(vget_low_u32(veq),vget_high_u32(veq));
+
+        vmin = vpmin_u32(vmin,vmin);
+        if ( vget_lane_u32(vmin,0) == 0 )
+            break;                  // A window opens or closes
+    }
+#else
+    for ( ; x + 4 <= n; x += 4 ) {
+        uint32_t diff = ( ((a[x] ^ b[x]) & mask) ^ open )
+            | ( ((a[x+1] ^ b[x+1]) & mask) ^ open )
+            | ( ((a[x+2] ^ b[x+2]) & mask) ^ open )
+            | ( ((a[x+3] ^ b[x+3]) & mask) ^ open );
+
+        if ( diff )
+            break;
+    }
+#endif
+    while ( x < n && ((a[x] ^ b[x]) & mask) == open )
+        ++x;
+    return x;
+}
+
+size_t
+CaptureCompare::compare(const uint32_t *a,size_t na,const uint32_t *b,size_t nb,int64_t lag) {
+    uint64_t start[CAPCMP_CHANNELS];
+    uint32_t open = 0;              // Channels with an open window
+
+    windows.clear();
+    this->lag = lag;
+
+    // Overlap of a[x] with b[x+lag]
+    uint64_t lo = lag < 0 ? uint64_t(-lag) : 0;
+    int64_t hi = std::min(int64_t(na),int64_t(nb) - lag);
+
+    first = lo;
+    compared = 0;
+    if ( hi <= int64_t(lo) )
+        return 0;
+
+    const uint32_t *pa = a + lo;
+    const uint32_t *pb = b + lo + lag;
+    const size_t n = size_t(hi - int64_t(lo));
+    size_t x = 0;
+
+    compared = n;
+
+    for (;;) {
+        x += steady_length(pa + x,pb + x,n - x,mask,open);
+        if ( x >= n )
+            break;
+
+        uint32_t diff = (pa[x] ^ pb[x]) & mask;
+        uint32_t changed = diff ^ open;
+
+        do  {
+            unsigned ch = __builtin_ctz(changed);
+
+            if ( (diff >> ch) & 1 ) {
+                start[ch] = x;      // Window opens
+            } else if ( x - start[ch] > tolerance ) {
+                s_mismatch mm = { ch, lo + start[ch], lo + x };
+
+                windows.push_back(mm);
+            }
+            changed &= changed - 1;
+        } while ( changed );
+
+        open = diff;
+        ++x;
+    }
+
+    // Close windows still open at the end
+    for ( ; open; open &= open - 1 ) {
+        unsigned ch = __builtin_ctz(open);
+
+        if ( n - start[ch] > tolerance ) {
+            s_mismatch mm = { ch, lo + start[ch], lo + n };
+
+            windows.push_back(mm);
+        }
+    }
+
+    return windows.size();
+}
+
+//////////////////////////////////////////////////////////////////////
+// Report mismatch windows, as sample indexes of a and as times
+//////////////////////////////////////////////////////////////////////
+
+void
+CaptureCompare::write(FILE *outf,double period_ns) const {
+    const double us = period_ns / 1000.0;
+
+    fprintf(outf,"Compared %llu samples from %llu (lag %lld), tolerance %u: %zu mismatch%s\n",
+        (unsigned long long)compared,(unsigned long long)first,(long long)lag,
+        tolerance,windows.size(),windows.size() == 1 ? "" : "es");
+
+    for ( const s_mismatch& mm : windows )
+        fprintf(outf,"gpio%-2u %12llu %12llu %10llu %14.3f us %12.3f us\n",
+            mm.channel,
+            (unsigned long long)mm.start,
+            (unsigned long long)mm.end,
+            (unsigned long long)(mm.end - mm.start),
+            mm.start * us,
+            (mm.end - mm.start) * us);
+}
+
+// End capcmp.cpp
@@ -0,0 +1,110 @@
+//////////////////////////////////////////////////////////////////////
+// debounce.cpp -- Vertical Counter Debouncer Implementation
+//
+// Each pin has a small counter, stored "vertically": planes[k] holds
+// bit k of all 64 counters, so one set of word operations counts
+// every pin at once. A pin's counter advances while its raw level
+// differs from its debounced state and clears when they agree. When
+// it reaches samples, the debounced state toggles. A sample costs a
+// few dozen instructions however many pins are debounced.
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+#include "debounce.hpp"
+
+Debouncer::Debouncer(unsigned samples,uint64_t mask) {
+
+    if ( samples < 1 )
+        samples = 1;
+    else if ( samples >= 1u << DEBOUNCE_PLANES )
+        samples = ( 1u << DEBOUNCE_PLANES ) - 1;
+
+    this->samples = samples;
+    this->mask = mask & ( ( uint64_t(GPIO_BANK1_MASK) << 32 ) | 0xFFFFFFFFull );
+
+    for ( unsigned k = 0; k < DEBOUNCE_PLANES; ++k )
+        match[k] = ( samples >> k ) & 1 ? ~uint64_t(0) : 0;
+
+    reset(0);
+}
+
+void
+Debouncer::reset(uint64_t levels) {
+
+    state = levels;
+    for ( unsigned k = 0; k < DEBOUNCE_PLANES; ++k )
+        planes[k] = 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Advance the counters of pins whose level differs from their state
+//////////////////////////////////////////////////////////////////////
+
+uint64_t
+Debouncer::feed(uint64_t levels,uint64_t time_ns) {
+    uint64_t delta = ( levels ^ state ) & mask;
+    uint64_t carry = delta, done = delta;
+
+    for ( unsigned k = 0; k < DEBOUNCE_PLANES; ++k ) {
+        uint64_t p = planes[k];
+
+        planes[k] = ( p ^ carry ) & delta;  // Count, or clear if steady
+        carry &= p;
+        done &= ~( planes[k] ^ match[k] );  // Counter == samples
+    }
+
+    if ( !done )
+        return 0;
+
+    state ^= done;
+    for ( unsigned k = 0; k < DEBOUNCE_PLANES; ++k )
+        planes[k] &= ~done;
+
+    if ( edge ) {
+        for ( uint64_t bits = done; bits; bits &= bits - 1 ) {
+            int gpio = __builtin_ctzll(bits);
+
+            edge(gpio,int(( state >> gpio ) & 1),time_ns);
+        }
+    }
+    return done;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Timed sampling loop: The first sample is taken as settled
+//////////////////////////////////////////////////////////////////////
+
+int
+Debouncer::run(GPIO& gpio,unsigned period_us,const std::atomic<bool>& running) {
+    struct timespec next;
+
+    if ( gpio.get_error() )
+        return gpio.get_error();
+    else if ( period_us < 1 )
+        return EINVAL;
+
+    reset(gpio.read_mask());
+    clock_gettime(CLOCK_MONOTONIC,&next);
+
+    while ( running ) {
+        next.tv_nsec += long(period_us) * 1000;
+        while ( next.tv_nsec >= 1000000000 ) {
+            next.tv_nsec -= 1000000000;
+            ++next.tv_sec;
+        }
+        while ( clock_nanosleep(CLOCK_MONOTONIC,TIMER_ABSTIME,&next,nullptr) == EINTR )
+            ;
+
+        feed(gpio.read_mask(),uint64_t(next.tv_sec) * 1000000000ull + next.tv_nsec);
+    }
+    return 0;
+}
+
+// End debounce.cpp
@@ -17,6 +17,7 @@
 #include <mutex>
 
 #include "mailbox.hpp"
+#include "regio.hpp"
 #include "dma.hpp"
 
 #define DMA_BASE_OFFSET     0x00007000
@@ -37,6 +38,7 @@
 
 static uint32_v *udma = 0;      // Pointer to DMA register 0
 static uint32_v *udma15 = 0;
+static RegIO *uio = 0;          // Backend that mapped the above
 static std::mutex memlock;
 static int usage_count = 0;
 
@@ -69,21 +71,22 @@ DMA::DMA() {
     if ( !udma ) {
         uint32_t peri_base = GPIO::peripheral_base();
 
-        udma = (uint32_v *)Mailbox::map(peri_base+DMA_BASE_OFFSET,page_size);
+        uio = RegIO::backend();
+        udma = (uint32_v *)uio->map(peri_base+DMA_BASE_OFFSET,page_size);
         if ( !udma ) {
             errcode = errno;
             memlock.unlock();
             return;
         }
 
-        udma15 = (uint32_v *)Mailbox::map(peri_base+DMA15_BASE_OFFSET,page_size);
+        udma15 = (uint32_v *)uio->map(peri_base+DMA15_BASE_OFFSET,page_size);
         if ( !udma15 ) {
             errcode = errno;
             memlock.unlock();
             return;
         }
-        ++usage_count;
     }
+    ++usage_count;
     memlock.unlock();
 
     channel = -1;
@@ -97,12 +100,12 @@ DMA::~DMA() {
     memlock.lock();
     if ( --usage_count <= 0 ) {
         if ( udma != 0 ) {
-            Mailbox::unmap((void*)udma,page_size);
+            uio->unmap((void*)udma,page_size);
             udma = 0;
         }
         if ( udma15 != 0 ) {
-            Mailbox::unmap((void *)udma15,page_size);
-            udma = 0;
+            uio->unmap((void *)udma15,page_size);
+            udma15 = 0;
         }
     }
     memlock.unlock();
@@ -145,4 +148,64 @@ DMA::set_channel(int ch) {
     return true;
 }
 
+//////////////////////////////////////////////////////////////////////
+// Reset the channel, and start the control block chain at bus
+// address cb_addr (the CBs must be 32 byte aligned, in memory that
+// the DMA sees uncached).
+//////////////////////////////////////////////////////////////////////
+
+bool
+DMA::start(uint32_t cb_addr,unsigned priority) {
+
+    if ( channel < 0 || (cb_addr & 0x1F) != 0 || priority > 15 )
+        return false;
+
+    abort();
+
+    conblk_ad() = cb_addr;
+    u_cs() = (1u << 28)                 // WAIT_FOR_OUTSTANDING_WRITES
+        | (priority << 20)              // PANIC_PRIORITY
+        | (priority << 16)              // PRIORITY
+        | 0x00000001;                   // ACTIVE
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Abort any transfer in progress and reset the channel
+//////////////////////////////////////////////////////////////////////
+
+void
+DMA::abort() {
+
+    if ( channel < 0 )
+        return;
+
+    if ( u_cs() & 0x00000001 ) {
+        u_cs() = 0;                     // Pause (clear ACTIVE)
+        for ( int tries = 0; tries < 100 && (u_cs() & 0x00000001); ++tries )
+            usleep(10);
+        u_cs() = 1u << 30;              // ABORT current CB
+    }
+
+    u_cs() = 1u << 31;                  // RESET channel
+    usleep(10);
+    u_cs() = 0x00000006;                // Clear END and INT
+    u_debug() = 0x00000007;             // Clear error flags
+}
+
+bool
+DMA::is_active() {
+    return channel >= 0 && (u_cs() & 0x00000001) != 0;
+}
+
+bool
+DMA::is_ended() {
+    return channel >= 0 && (u_cs() & 0x00000002) != 0;
+}
+
+bool
+DMA::is_error() {
+    return channel >= 0 && (u_cs() & 0x00000100) != 0;
+}
+
 // End dma.cpp
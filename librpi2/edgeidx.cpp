@@ -0,0 +1,189 @@
+//////////////////////////////////////////////////////////////////////
+// edgeidx.cpp -- Per-Channel Edge Index Implementation
+//
+// One pass over the capture XORs adjacent samples, and bit-scans the
+// changed bits into per-channel sorted lists of transition indexes.
+// Blocks are shared out amongst threads, and the per-block results
+// are concatenated in block order. Analyses can then work in time
+// proportional to the number of edges, rather than samples.
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#include <assert.h>
+
+#include <algorithm>
+#include <thread>
+
+#include "edgeidx.hpp"
+
+EdgeIndex::EdgeIndex() {
+    initial = 0;
+    n_samples = 0;
+}
+
+void
+EdgeIndex::clear() {
+
+    for ( unsigned ux = 0; ux < EDGEIDX_CHANNELS; ++ux )
+        chan_edges[ux].clear();
+    initial = 0;
+    n_samples = 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Collect the edges of one block (base is the index of its first
+// sample, prev the sample preceding it)
+//////////////////////////////////////////////////////////////////////
+
+static void
+index_block(
+  const uint32_t *samples,
+  size_t n,
+  uint32_t base,
+  uint32_t prev,
+  std::vector<uint32_t> *edges) {
+
+    for ( size_t x = 0; x < n; ++x ) {
+        uint32_t changed = samples[x] ^ prev;
+
+        prev = samples[x];
+        while ( changed ) {
+            unsigned bit = __builtin_ctz(changed);
+
+            edges[bit].push_back(base + uint32_t(x));
+            changed &= changed - 1; // Clear lowest set bit
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+// Index consecutive ranges of samples, one range at a time per thread
+//////////////////////////////////////////////////////////////////////
+
+void
+EdgeIndex::build(const std::vector<s_range>& ranges,unsigned threads) {
+    size_t n_blocks = ranges.size();
+    std::vector<uint32_t> bases(n_blocks);
+
+    clear();
+    if ( n_blocks < 1 )
+        return;
+
+    for ( size_t bx = 0; bx < n_blocks; ++bx ) {
+        bases[bx] = n_samples;
+        n_samples += uint32_t(ranges[bx].n);
+    }
+    initial = ranges[0].samples[0];
+
+    if ( threads == 0 )
+        threads = std::max(1u,std::thread::hardware_concurrency());
+    if ( threads > n_blocks )
+        threads = unsigned(n_blocks);
+
+    // Per block results, filled in by the threads
+    std::vector<std::vector<uint32_t> > results(n_blocks * EDGEIDX_CHANNELS);
+    std::vector<std::thread> workers;
+
+    auto worker = [&](unsigned tx) {
+        for ( size_t bx = tx; bx < n_blocks; bx += threads ) {
+            const s_range& range = ranges[bx];
+            uint32_t prev = bx > 0 ? ranges[bx-1].samples[ranges[bx-1].n-1] : initial;
+
+            index_block(range.samples,range.n,bases[bx],prev,
+                &results[bx * EDGEIDX_CHANNELS]);
+        }
+    };
+
+    for ( unsigned tx = 1; tx < threads; ++tx )
+        workers.push_back(std::thread(worker,tx));
+    worker(0);
+    for ( auto& thread : workers )
+        thread.join();
+
+    // Concatenate in block order
+    for ( unsigned ch = 0; ch < EDGEIDX_CHANNELS; ++ch ) {
+        size_t total = 0;
+
+        for ( size_t bx = 0; bx < n_blocks; ++bx )
+            total += results[bx * EDGEIDX_CHANNELS + ch].size();
+
+        chan_edges[ch].reserve(total);
+        for ( size_t bx = 0; bx < n_blocks; ++bx ) {
+            const std::vector<uint32_t>& part = results[bx * EDGEIDX_CHANNELS + ch];
+
+            chan_edges[ch].insert(chan_edges[ch].end(),part.begin(),part.end());
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+// Index capture blocks of samps samples each
+//////////////////////////////////////////////////////////////////////
+
+void
+EdgeIndex::build(const std::vector<const uint32_t*>& blocks,size_t samps,unsigned threads) {
+    std::vector<s_range> ranges;
+
+    if ( samps > 0 ) {
+        for ( const uint32_t *block : blocks ) {
+            s_range range = { block, samps };
+
+            ranges.push_back(range);
+        }
+    }
+    build(ranges,threads);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Index one contiguous array, split into slices for the threads
+//////////////////////////////////////////////////////////////////////
+
+void
+EdgeIndex::build(const uint32_t *samples,size_t n,unsigned threads) {
+    std::vector<s_range> ranges;
+    const size_t slice = 64 * 1024; // Samples per slice
+
+    for ( size_t x = 0; x < n; x += slice ) {
+        s_range range = { samples + x, std::min(slice,n - x) };
+
+        ranges.push_back(range);
+    }
+    build(ranges,threads);
+}
+
+size_t
+EdgeIndex::edges(unsigned channel,uint32_t from,uint32_t to,const uint32_t **first) const {
+
+    assert(channel < EDGEIDX_CHANNELS);
+
+    const std::vector<uint32_t>& list = chan_edges[channel];
+    auto lo = std::lower_bound(list.begin(),list.end(),from);
+    auto hi = std::lower_bound(lo,list.end(),to);
+
+    if ( first )
+        *first = hi != lo ? &*lo : 0;
+    return to > from ? size_t(hi - lo) : 0;
+}
+
+size_t
+EdgeIndex::edges(unsigned channel) const {
+
+    assert(channel < EDGEIDX_CHANNELS);
+    return chan_edges[channel].size();
+}
+
+int
+EdgeIndex::level(unsigned channel,uint32_t index) const {
+
+    assert(channel < EDGEIDX_CHANNELS);
+
+    const std::vector<uint32_t>& list = chan_edges[channel];
+    size_t n = std::upper_bound(list.begin(),list.end(),index) - list.begin();
+
+    return int(((initial >> channel) ^ n) & 1);
+}
+
+// End edgeidx.cpp
@@ -27,7 +27,7 @@
 #include <assert.h>
 
 #include "gpio.hpp"
-#include "mailbox.hpp"
+#include "regio.hpp"
 #include "piutils.hpp"
 
 #include <mutex>
@@ -53,10 +53,14 @@
 
 #define GPIO_GPFSEL0	0x7E200000 
 #define GPIO_GPSET0	0x7E20001C
+#define GPIO_GPSET1	0x7E200020
 #define GPIO_GPCLR0	0x7E200028 
+#define GPIO_GPCLR1	0x7E20002C
 #define GPIO_GPLEV0     0x7E200034 
+#define GPIO_GPLEV1     0x7E200038
 
 #define GPIO_GPEDS0 	0x7E200040 
+#define GPIO_GPEDS1 	0x7E200044
 #define GPIO_GPREN0	0x7E20004C 
 #define GPIO_GPFEN0     0x7E200058 
 #define GPIO_GPHEN0     0x7E200064 
@@ -67,13 +71,14 @@
 
 #define GPIO_GPPUD	0x7E200094
 #define GPIO_GPUDCLK0	0x7E200098
-#define GPIO_GPUDCLK1	0x7E200098
+#define GPIO_GPUDCLK1	0x7E20009C
 
 #define PADSOFF(o)	(((o)-0x7E000000-PADS_BASE_OFFSET)/sizeof(uint32_t))
 #define PADSREG(o,x)	(*(upads+PADSOFF(o)+x))
 
 #define GPIO_PADS00_27	0x7E10002C
 #define GPIO_PADS28_45	0x7E100030 
+#define GPIO_PADS46_53	0x7E100034
 
 //////////////////////////////////////////////////////////////////////
 // Clock Peripherals
@@ -215,6 +220,8 @@ static uint32_v *ugpio = 0;     // Pointer to Peripheral space
 static uint32_v *upads = 0;	// Pointer to GPIO pad space
 static uint32_v *uclock = 0;    // Pointer to CM_GP0CTL space
 static uint32_v *upwm = 0;	// Pointer to PWM_CTL space
+static RegIO *uio = 0;          // Backend that mapped the above
+static RegIO *usim = 0;         // uio, when it must see stores
 static std::mutex uglock;       // Mutex for ugpio
 static int usage_count = 0;
 static uint32_t block_size = 0; // System block size
@@ -298,6 +305,16 @@ static std::unordered_map<int,std::unordered_map<int,std::string>*>
         { GPIO::Alt5, &gpio_alt5}
     };
 
+//////////////////////////////////////////////////////////////////////
+// Tell a simulated backend that a register was written
+//////////////////////////////////////////////////////////////////////
+
+static inline void
+stored(uint32_v& reg) {
+    if ( usim )
+        usim->stored(&reg);
+}
+
 //////////////////////////////////////////////////////////////////////
 // Inline functions to calculate GPIO offset and shift
 //////////////////////////////////////////////////////////////////////
@@ -336,17 +353,19 @@ GPIO::GPIO() {
         }
 
         peri_base = GPIO::peripheral_base();
+        uio = RegIO::backend();
 
-        ugpio = (uint32_v *)Mailbox::map(peri_base+GPIO_BASE_OFFSET,block_size);
+        ugpio = (uint32_v *)uio->map(peri_base+GPIO_BASE_OFFSET,block_size);
         if ( !ugpio ) {
             errcode = errno;
             uglock.unlock();
             return;             // Failed
         }
 
-	upads = (uint32_v *)Mailbox::map(peri_base+PADS_BASE_OFFSET,block_size);
-        upwm = (uint32_v *)Mailbox::map(peri_base+PWM_BASE_OFFSET,block_size);
-        uclock = (uint32_v *)Mailbox::map(peri_base+CLOCK_BASE_OFFSET,block_size);
+	upads = (uint32_v *)uio->map(peri_base+PADS_BASE_OFFSET,block_size);
+        upwm = (uint32_v *)uio->map(peri_base+PWM_BASE_OFFSET,block_size);
+        uclock = (uint32_v *)uio->map(peri_base+CLOCK_BASE_OFFSET,block_size);
+        usim = uio->simulated() ? uio : 0;
     }
 
     ++usage_count;              // Successful
@@ -361,21 +380,22 @@ GPIO::~GPIO() {
     uglock.lock();
     if ( --usage_count <= 0 ) {
         if ( ugpio ) {
-            Mailbox::unmap((void *)ugpio,block_size);
+            uio->unmap((void *)ugpio,block_size);
             ugpio = 0;
         }
         if ( upads ) {
-            Mailbox::unmap((void *)upads,block_size);
+            uio->unmap((void *)upads,block_size);
             upads = 0;
         }
         if ( upwm ) {
-            Mailbox::unmap((void *)upwm,block_size);
+            uio->unmap((void *)upwm,block_size);
 	    upwm = 0;
         }
         if ( uclock ) {
-	    Mailbox::unmap((void *)uclock,block_size);
+	    uio->unmap((void *)uclock,block_size);
 	    uclock = 0;
         }
+        usim = 0;
     }
     uglock.unlock();
 }
@@ -391,11 +411,12 @@ GPIO::configure(int gpio,IO io) {
 
     if ( errcode )
         return errcode;         // /dev/mem open failed
-    else if ( gpio < 0 )
+    else if ( gpio < 0 || gpio > GPIO_MAX )
         return EINVAL;          // Invalid parameter
 
     uint32_v& gpiosel = set_gpio10(gpio,shift,GPIO_GPFSEL0);
     gpiosel = (gpiosel & ~(7<<shift)) | (alt<<shift);	
+    stored(gpiosel);
     return 0;
 }
 
@@ -409,7 +430,7 @@ GPIO::alt_function(int gpio,IO& io) {
 
     if ( errcode )
         return errcode;         // /dev/mem open failed
-    else if ( gpio < 0 )
+    else if ( gpio < 0 || gpio > GPIO_MAX )
         return EINVAL;          // Invalid parameter
 
     uint32_v& gpiosel = set_gpio10(gpio,shift,GPIO_GPFSEL0);
@@ -428,10 +449,13 @@ GPIO::get_drive_strength(int gpio,bool& slew_limited,bool& hysteresis,int &drive
 
     if ( errcode )
         return errcode;         // /dev/mem open failed
-    else if ( gpio < 0 || gpio > 53 )
+    else if ( gpio < 0 || gpio > GPIO_MAX )
         return EINVAL;          // Invalid parameter
 
-    uint32_t padx = gpio / 28;
+    if ( !upads )
+        return EACCES;              // GPIO only (/dev/gpiomem)
+
+    uint32_t padx = gpio < 28 ? 0 : gpio < 46 ? 1 : 2; // 0-27, 28-45, 46-53
     uint32_v& padreg = PADSREG(GPIO_PADS00_27,padx);
 
     drive = padreg & 7;
@@ -445,10 +469,13 @@ GPIO::set_drive_strength(int gpio,bool slew_limited,bool hysteresis,int drive) {
 
     if ( errcode )
         return errcode;         // /dev/mem open failed
-    else if ( gpio < 0 || gpio > 53 )
+    else if ( gpio < 0 || gpio > GPIO_MAX )
         return EINVAL;          // Invalid parameter
 
-    uint32_t padx = gpio / 28;
+    if ( !upads )
+        return EACCES;              // GPIO only (/dev/gpiomem)
+
+    uint32_t padx = gpio < 28 ? 0 : gpio < 46 ? 1 : 2; // 0-27, 28-45, 46-53
     uint32_v& padreg = PADSREG(GPIO_PADS00_27,padx);
 
     uint32_t config = 0x5A000000;
@@ -459,6 +486,7 @@ GPIO::set_drive_strength(int gpio,bool slew_limited,bool hysteresis,int drive) {
     config |= drive & 7;
 
     padreg = config;
+    stored(padreg);
     return 0;
 }
 
@@ -471,10 +499,10 @@ GPIO::configure(int gpio,Pull pull) {
     
     if ( errcode )
         return errcode;             // /dev/mem open failed
-    else if ( gpio < 0 || gpio >= 32 )
+    else if ( gpio < 0 || gpio > GPIO_MAX )
         return EINVAL;              // Invalid parameter
 
-    uint32_t mask = 1 << gpio;      // GPIOs 0 to 31 only
+    int shift;
     uint32_t pmask;
 
     switch ( pull ) {
@@ -490,15 +518,19 @@ GPIO::configure(int gpio,Pull pull) {
     };
 
     uint32_v& GPPUD = GPIOREG(GPIO_GPPUD);
-    uint32_v& GPUDCLK0 = GPIOREG(GPIO_GPUDCLK0);
+    uint32_v& GPUDCLKn = set_gpio32(gpio,shift,GPIO_GPUDCLK0); // GPUDCLK0 or 1
 
     GPPUD = pmask;                  // Select pullup setting
+    stored(GPPUD);
     GPIO::delay();
-    GPUDCLK0 = mask;                // Set the GPIO of interest
+    GPUDCLKn = 1u << shift;         // Set the GPIO of interest
+    stored(GPUDCLKn);
     GPIO::delay();
     GPPUD = 0;                      // Reset pmask
+    stored(GPPUD);
     GPIO::delay();
-    GPUDCLK0 = 0;                   // Set the GPIO of interest
+    GPUDCLKn = 0;                   // Set the GPIO of interest
+    stored(GPUDCLKn);
     GPIO::delay();
 
     return 0;
@@ -514,14 +546,13 @@ GPIO::clear_event(int gpio) {
 
     if ( errcode != 0 )
         return errcode;             // /dev/mem did not open
-    else if ( gpio < 0 )
+    else if ( gpio < 0 || gpio > GPIO_MAX )
         return EINVAL;
 
-    uint32_v& gpeds0 = set_gpio32(gpio,shift,GPIO_GPEDS0);
+    uint32_v& gpeds = set_gpio32(gpio,shift,GPIO_GPEDS0);
 
-    gpeds0 |= (1 << shift);
-    GPIO::delay();
-    gpeds0 = 0;
+    gpeds = 1u << shift;            // Write 1 clears only this event
+    stored(gpeds);
 
     return 0;
 }
@@ -537,7 +568,7 @@ GPIO::configure(int gpio,Event event,bool enable) {
 
     if ( errcode != 0 )
         return errcode;             // /dev/mem did not open
-    else if ( gpio < 0 )
+    else if ( gpio < 0 || gpio > GPIO_MAX )
         return EINVAL;
 
     switch ( event ) {
@@ -564,9 +595,10 @@ GPIO::configure(int gpio,Event event,bool enable) {
     uint32_v& gplen = set_gpio32(gpio,shift,base);
 
     if ( enable )
-        gplen |= (1 << shift);
+        gplen |= (1u << shift);
     else
-        gplen &= ~(1 << shift);
+        gplen &= ~(1u << shift);
+    stored(gplen);
 
     clear_event(gpio);
 
@@ -582,7 +614,7 @@ GPIO::events_off(int gpio) {
 
     if ( errcode != 0 )
         return errcode;             // /dev/mem did not open
-    else if ( gpio < 0 )
+    else if ( gpio < 0 || gpio > GPIO_MAX )
         return EINVAL;
 
     configure(gpio,Rising,false);
@@ -602,12 +634,12 @@ GPIO::read_event(int gpio) {
 
     if ( errcode != 0 )
         return errcode;             // /dev/mem did not open
-    else if ( gpio < 0 )
+    else if ( gpio < 0 || gpio > GPIO_MAX )
         return EINVAL;
 
-    uint32_v& gpeds0 = set_gpio32(gpio,shift,GPIO_GPEDS0);
+    uint32_v& gpeds = set_gpio32(gpio,shift,GPIO_GPEDS0);
 
-    event = !!(gpeds0 & (1 << shift));
+    event = !!(gpeds & (1 << shift));
 
     if ( event ) 
         clear_event(gpio);
@@ -631,6 +663,43 @@ GPIO::read_events() {
     return gpeds0;
 }
 
+//////////////////////////////////////////////////////////////////////
+// Read the events of GPIO 0-53 (bit x is GPIO x), without clearing
+//////////////////////////////////////////////////////////////////////
+
+uint64_t
+GPIO::read_events_mask() {
+
+    if ( errcode != 0 )
+        return 0;                   // /dev/mem did not open
+
+    uint32_t eds0 = GPIOREG(GPIO_GPEDS0);
+    uint32_t eds1 = GPIOREG(GPIO_GPEDS1);
+
+    return ( uint64_t(eds1 & GPIO_BANK1_MASK) << 32 ) | eds0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Clear the events of the GPIOs in mask, with one store per bank
+//////////////////////////////////////////////////////////////////////
+
+int
+GPIO::clear_events_mask(uint64_t mask) {
+
+    if ( errcode != 0 )
+        return errcode;             // /dev/mem did not open
+
+    if ( uint32_t(mask) ) {
+        GPIOREG(GPIO_GPEDS0) = uint32_t(mask);
+        stored(GPIOREG(GPIO_GPEDS0));
+    }
+    if ( uint32_t(mask >> 32) & GPIO_BANK1_MASK ) {
+        GPIOREG(GPIO_GPEDS1) = uint32_t(mask >> 32) & GPIO_BANK1_MASK;
+        stored(GPIOREG(GPIO_GPEDS1));
+    }
+    return 0;
+}
+
 //////////////////////////////////////////////////////////////////////
 // Read a GPIO pin
 //////////////////////////////////////////////////////////////////////
@@ -641,12 +710,12 @@ GPIO::read(int gpio) {
     
     if ( errcode != 0 )
         return errcode;             // /dev/mem did not open
-    else if ( gpio < 0 || gpio > 31 )
+    else if ( gpio < 0 || gpio > GPIO_MAX )
         return EINVAL;
 
     uint32_v& gpiolev = set_gpio32(gpio,shift,GPIO_GPLEV0);
 
-    return !!(gpiolev & (1<<shift));
+    return !!(gpiolev & (1u<<shift));
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -657,12 +726,17 @@ int
 GPIO::write(int gpio,int bit) {
     int shift;
     
+    if ( gpio < 0 || gpio > GPIO_MAX )
+        return EINVAL;
+
     if ( bit ) {
         uint32_v& gpioset = set_gpio32(gpio,shift,GPIO_GPSET0);
         gpioset = 1u << shift;
+        stored(gpioset);
     } else {
         uint32_v& gpioclr = set_gpio32(gpio,shift,GPIO_GPCLR0);
         gpioclr = 1u << shift;
+        stored(gpioclr);
     }
     return 0;
 }
@@ -682,6 +756,56 @@ GPIO::read() {
     return gpiolev;
 }
 
+//////////////////////////////////////////////////////////////////////
+// Change several pins with one store per register: All pins in
+// clear go low together, and then all pins in set go high together.
+// Only the GPCLRn/GPSETn words with bits to change are written.
+//////////////////////////////////////////////////////////////////////
+
+int
+GPIO::write_mask(uint64_t set,uint64_t clear) {
+
+    if ( errcode != 0 )
+        return errcode;             // /dev/mem did not open
+
+    if ( uint32_t(clear) )
+        GPIOREG(GPIO_GPCLR0) = uint32_t(clear);
+    if ( uint32_t(clear >> 32) )
+        GPIOREG(GPIO_GPCLR1) = uint32_t(clear >> 32);
+    if ( uint32_t(set) )
+        GPIOREG(GPIO_GPSET0) = uint32_t(set);
+    if ( uint32_t(set >> 32) )
+        GPIOREG(GPIO_GPSET1) = uint32_t(set >> 32);
+    if ( usim )
+        usim->stored(&GPIOREG(GPIO_GPSET0)); // Applies all four
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Read the levels of GPIO 0-53 (bit x is GPIO x)
+//////////////////////////////////////////////////////////////////////
+
+uint64_t
+GPIO::read_mask() {
+
+    if ( errcode != 0 )
+        return 0;                   // /dev/mem did not open
+
+    uint32_t lev0 = GPIOREG(GPIO_GPLEV0);
+    uint32_t lev1 = GPIOREG(GPIO_GPLEV1);
+
+    return ( uint64_t(lev1 & GPIO_BANK1_MASK) << 32 ) | lev0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Return the mapped GPIO register block (nullptr if not mapped)
+//////////////////////////////////////////////////////////////////////
+
+uint32_v *
+GPIO::registers() {
+    return errcode ? nullptr : ugpio;
+}
+
 //////////////////////////////////////////////////////////////////////
 // A short configuration delay
 //////////////////////////////////////////////////////////////////////
@@ -693,6 +817,20 @@ GPIO::delay() {
     }
 }
 
+//////////////////////////////////////////////////////////////////////
+// Return 0 if the clock registers can be used, else an errno value
+//////////////////////////////////////////////////////////////////////
+
+int
+GPIO::clock_access() {
+
+    if ( errcode )
+        return errcode;             // Failed mmap/open
+    else if ( !uclock )
+        return EACCES;              // GPIO only (/dev/gpiomem)
+    return 0;
+}
+
 //////////////////////////////////////////////////////////////////////
 // Start clock on GPIO 4
 //////////////////////////////////////////////////////////////////////
@@ -710,8 +848,8 @@ GPIO::start_clock(
     int rc, pwmx;
     IO altf;
 
-    if ( errcode )
-        return errcode;         // Failed mmap/open
+    if ( (rc = clock_access()) != 0 )
+        return rc;
 
     if ( gpio == GPIO_CLOCK ) {
         // GP0 clock
@@ -755,6 +893,7 @@ GPIO::start_clock(
     tmpctl.s.MASH = mash;
     tmpctl.s.PASSWD = 0x5A;
     regctl.u = tmpctl.u;       // Configured but not enabled
+    stored(regctl.u);
 
     uswait(100);
 
@@ -766,6 +905,7 @@ GPIO::start_clock(
     tmpdiv.s.DIVI = divi;
     tmpdiv.s.PASSWD = 0x5A;
     regdiv.u = tmpdiv.u;
+    stored(regdiv.u);
 
     uswait(100);
 
@@ -775,6 +915,7 @@ GPIO::start_clock(
     tmpctl.s.ENAB = 1;
     tmpctl.s.PASSWD = 0x5A;
     regctl.u = tmpctl.u;
+    stored(regctl.u);
 
     uswait(100);
 
@@ -799,8 +940,8 @@ GPIO::config_clock(
     int rc, pwmx;
     IO altf;
 
-    if ( errcode )
-        return errcode;         // Failed mmap/open
+    if ( (rc = clock_access()) != 0 )
+        return rc;
 
     if ( gpio == GPIO_CLOCK ) {
         // GP0 clock
@@ -840,8 +981,8 @@ GPIO::stop_clock(int gpio) {
     int rc, pwmx = -1;
     IO altf;
 
-    if ( errcode )
-        return errcode;             // Failed mmap/open
+    if ( (rc = clock_access()) != 0 )
+        return rc;
 
     if ( gpio == GPIO_CLOCK ) {
         // GP0 clock
@@ -862,6 +1003,7 @@ GPIO::stop_clock(int gpio) {
     tmpctl.s.ENAB = 0;
     tmpctl.s.PASSWD = 0x5A;
     regctl.u = tmpctl.u;
+    stored(regctl.u);
 
     while ( regctl.s.BUSY )
         ;
@@ -871,7 +1013,8 @@ GPIO::stop_clock(int gpio) {
 }
 
 //////////////////////////////////////////////////////////////////////
-// Utility: Return the PWM unit # based upon gpio
+// Utility: Return the PWM unit # based upon gpio (EACCES when the
+// PWM registers are not mapped)
 //////////////////////////////////////////////////////////////////////
 
 int
@@ -900,6 +1043,8 @@ GPIO::pwm(int gpio,int& pwm,IO& altf) {
         return EINVAL;              // Only have PWM 0 and 1 available
     }
 
+    if ( !upwm )
+        return EACCES;              // GPIO only (/dev/gpiomem)
     return 0;
 }
 
@@ -930,6 +1075,7 @@ GPIO::pwm_configure(int gpio,PwmMode mode,bool repeat,int state,bool invert,bool
         return rc;                  // Return error
 
     regdmac.s.ENAB = 0;             // Disable DMA
+    stored(regdmac.u);
 
     //////////////////////////////////////////////////////////////////
     // Disable the PWM peripheral
@@ -939,6 +1085,7 @@ GPIO::pwm_configure(int gpio,PwmMode mode,bool repeat,int state,bool invert,bool
     case 0:
 	if ( regctl.s.PWEN1 ) {
 		regctl.s.PWEN1 = 0;
+		stored(regctl.u);
 		while ( regsta.s.STA1 )
 			;
 	}
@@ -946,6 +1093,7 @@ GPIO::pwm_configure(int gpio,PwmMode mode,bool repeat,int state,bool invert,bool
     case 1:
 	if ( regctl.s.PWEN2 ) {
 		regctl.s.PWEN2 = 0;
+		stored(regctl.u);
 		while ( regsta.s.STA2 )
 			;
 	}
@@ -969,6 +1117,7 @@ GPIO::pwm_configure(int gpio,PwmMode mode,bool repeat,int state,bool invert,bool
         if ( regsta.s.WERR1 )
             tmpsta.s.WERR1 = 1;     // Clear FIFO write error
         regsta.u = tmpsta.u;
+        stored(regsta.u);
         GPIO::delay();
     }
 
@@ -1001,6 +1150,7 @@ GPIO::pwm_configure(int gpio,PwmMode mode,bool repeat,int state,bool invert,bool
 
     tmpctl.s.CLRF1 = 1;                // Clear FIFO
     regctl.u = tmpctl.u;
+    stored(regctl.u);
     usleep(10);
 
     return 0;
@@ -1102,7 +1252,9 @@ GPIO::pwm_ratio(int gpio,uint32_t m,uint32_t s) {
             u_PWM_DAT& regdat = PWMDAT(PWM_DAT1);
 
             regrng.u = s;
+            stored(regrng.u);
             regdat.u = m;
+            stored(regdat.u);
         }
         break;
     case 1:
@@ -1111,7 +1263,9 @@ GPIO::pwm_ratio(int gpio,uint32_t m,uint32_t s) {
             u_PWM_DAT& regdat = PWMDAT(PWM_DAT2);
 
             regrng.u = s;
+            stored(regrng.u);
             regdat.u = m;
+            stored(regdat.u);
         }
         break;
     default:
@@ -1175,14 +1329,20 @@ GPIO::pwm_enable(int gpio,bool enable) {
 
     switch ( pwm ) {
     case 0:
-        if ( enable && regsta.s.GAPO1 )
+        if ( enable && regsta.s.GAPO1 ) {
             regsta.s.GAPO1 = 1;
+            stored(regsta.u);
+        }
         regctl.s.PWEN1 = enable ? 1 : 0;
+        stored(regctl.u);
         break;
     case 1:
-        if ( enable && regsta.s.GAPO2 )
+        if ( enable && regsta.s.GAPO2 ) {
             regsta.s.GAPO2 = 1;
+            stored(regsta.u);
+        }
         regctl.s.PWEN2 = enable ? 1 : 0;
+        stored(regctl.u);
         break;
     default:
         assert(0);;
@@ -1191,6 +1351,41 @@ GPIO::pwm_enable(int gpio,bool enable) {
     return 0;
 }
 
+//////////////////////////////////////////////////////////////////////
+// Enable/disable PWM DMA requests (DREQ 5) from the PWM FIFO.
+//
+// Note:
+//  1. DREQ is asserted while the FIFO holds fewer than dreq words,
+//     so a low threshold makes the FIFO drain rate pace the DMA.
+//  2. pwm_configure() disables DMA, so call this afterwards.
+//////////////////////////////////////////////////////////////////////
+
+int
+GPIO::pwm_dma(int gpio,bool enable,unsigned dreq,unsigned panic) {
+    u_PWM_DMAC& regdmac = PWMDMAC(PWM_DMAC);
+    u_PWM_DMAC tmpdmac;
+    int pwm, rc;
+    IO altf;
+
+    if ( errcode )
+        return errcode;             // Failed mmap/open
+
+    if ( (rc = GPIO::pwm(gpio,pwm,altf)) != 0 )
+        return rc;                  // Return error
+
+    if ( dreq > 255 || panic > 255 )
+        return EINVAL;
+
+    tmpdmac.u = 0;
+    tmpdmac.s.DREQ = dreq;
+    tmpdmac.s.PANIC = panic;
+    tmpdmac.s.ENAB = enable ? 1 : 0;
+    regdmac.u = tmpdmac.u;
+    stored(regdmac.u);
+
+    return 0;
+}
+
 //////////////////////////////////////////////////////////////////////
 // Write to PWM FIFO
 //
@@ -1230,6 +1425,7 @@ GPIO::pwm_write_fifo(int gpio,uint32_t *data,size_t& n_words) {
 
     for ( ; count < n_words; ++count ) {
         regfifo.u = data[count];
+        stored(regfifo.u);
         if ( regsta.s.WERR1 || regsta.s.BERR ) {
             n_words = count;        // Return count written out
             return EIO;
@@ -1277,6 +1473,7 @@ GPIO::pwm_clear_status(int gpio,const s_PWM_status& status) {
     }
 
     regsta.u = tmpsta.u;
+    stored(regsta.u);
 
     return 0;
 }
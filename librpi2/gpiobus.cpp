@@ -0,0 +1,99 @@
+//////////////////////////////////////////////////////////////////////
+// gpiobus.cpp -- GPIO Parallel Bus Implementation
+//
+// A value is mapped to pins a nibble at a time, by table lookup, so
+// that a write is a few ORs followed by GPIO::write_mask(): One
+// GPCLRn and one GPSETn store moves every pin of the bus.
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+#include "gpiobus.hpp"
+
+GPIOBus::GPIOBus(GPIO& gpio,const int *pins,unsigned n_bits) : gpio(gpio) {
+
+    errcode = 0;
+    mask = 0;
+    memset(this->pins,0,sizeof this->pins);
+    memset(nibbles,0,sizeof nibbles);
+
+    if ( n_bits < 1 || n_bits > GPIOBUS_MAX_BITS ) {
+        errcode = EINVAL;
+        this->n_bits = 0;
+        return;
+    }
+    this->n_bits = n_bits;
+
+    for ( unsigned bx = 0; bx < n_bits; ++bx ) {
+        if ( pins[bx] < 0 || pins[bx] > GPIO_MAX || (mask & (uint64_t(1) << pins[bx])) ) {
+            errcode = EINVAL;       // Bad or repeated pin
+            this->n_bits = 0;
+            mask = 0;
+            return;
+        }
+        this->pins[bx] = pins[bx];
+        mask |= uint64_t(1) << pins[bx];
+    }
+
+    for ( unsigned nx = 0; nx < GPIOBUS_MAX_BITS/4; ++nx ) {
+        for ( unsigned v = 0; v < 16; ++v ) {
+            for ( unsigned b = 0; b < 4; ++b ) {
+                unsigned bx = nx * 4 + b;
+
+                if ( bx < n_bits && (v & (1 << b)) )
+                    nibbles[nx][v] |= uint64_t(1) << pins[bx];
+            }
+        }
+    }
+}
+
+int
+GPIOBus::configure(GPIO::IO io) {
+    int rc;
+
+    if ( errcode )
+        return errcode;
+
+    for ( unsigned bx = 0; bx < n_bits; ++bx )
+        if ( (rc = gpio.configure(pins[bx],io)) != 0 )
+            return rc;
+    return 0;
+}
+
+uint64_t
+GPIOBus::pin_mask(uint32_t value) {
+    uint64_t set = 0;
+
+    for ( unsigned nx = 0; nx * 4 < n_bits; ++nx, value >>= 4 )
+        set |= nibbles[nx][value & 0x0F];
+    return set;
+}
+
+int
+GPIOBus::write(uint32_t value) {
+    uint64_t set;
+
+    if ( errcode )
+        return errcode;
+
+    set = pin_mask(value);
+    return gpio.write_mask(set,mask & ~set);
+}
+
+uint32_t
+GPIOBus::read() {
+    uint64_t levels = gpio.read_mask();
+    uint32_t value = 0;
+
+    for ( unsigned bx = 0; bx < n_bits; ++bx )
+        value |= uint32_t((levels >> pins[bx]) & 1) << bx;
+    return value;
+}
+
+// End gpiobus.cpp
@@ -0,0 +1,161 @@
+//////////////////////////////////////////////////////////////////////
+// gpioevt.cpp -- GPIO Edge Events Implementation
+//
+// Uses the line event interface of the GPIO character device (Linux
+// 4.8 and later): The kernel timestamps each edge from its interrupt
+// and queues it, so no edge between reads is lost, and a waiting
+// reader costs no CPU. Timestamps are CLOCK_MONOTONIC on Linux 5.7 and
+// later (CLOCK_REALTIME before).
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/poll.h>
+#include <linux/gpio.h>
+
+#include <algorithm>
+
+#include "gpioevt.hpp"
+
+GPIOEvents::GPIOEvents(const char *chip) {
+
+    for ( int gpio = 0; gpio <= GPIO_MAX; ++gpio )
+        fds[gpio] = -1;
+
+    errcode = 0;
+    chip_fd = ::open(chip,O_RDONLY);
+    if ( chip_fd < 0 )
+        errcode = errno;
+}
+
+GPIOEvents::~GPIOEvents() {
+
+    while ( !watched.empty() )
+        unwatch(watched.back());
+
+    if ( chip_fd >= 0 )
+        ::close(chip_fd);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Request edge events for gpio
+//////////////////////////////////////////////////////////////////////
+
+int
+GPIOEvents::watch(int gpio,Edge edge,const char *consumer) {
+    struct gpioevent_request req;
+
+    if ( errcode )
+        return errcode;             // Chip did not open
+    else if ( gpio < 0 || gpio > GPIO_MAX || !(edge & Both) )
+        return EINVAL;
+
+    unwatch(gpio);
+
+    memset(&req,0,sizeof req);
+    req.lineoffset = gpio;
+    req.handleflags = GPIOHANDLE_REQUEST_INPUT;
+    req.eventflags = ( edge & Rising ? GPIOEVENT_REQUEST_RISING_EDGE : 0 )
+        | ( edge & Falling ? GPIOEVENT_REQUEST_FALLING_EDGE : 0 );
+    strncpy(req.consumer_label,consumer,sizeof req.consumer_label-1);
+
+    if ( ioctl(chip_fd,GPIO_GET_LINEEVENT_IOCTL,&req) < 0 )
+        return errno;               // EBUSY if another consumer has it
+
+    fds[gpio] = req.fd;
+    watched.push_back(gpio);
+    return 0;
+}
+
+int
+GPIOEvents::unwatch(int gpio) {
+
+    if ( gpio < 0 || gpio > GPIO_MAX || fds[gpio] < 0 )
+        return EINVAL;
+
+    ::close(fds[gpio]);
+    fds[gpio] = -1;
+    watched.erase(std::find(watched.begin(),watched.end(),gpio));
+    return 0;
+}
+
+int
+GPIOEvents::value(int gpio) {
+    struct gpiohandle_data data;
+
+    if ( gpio < 0 || gpio > GPIO_MAX || fds[gpio] < 0 ) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if ( ioctl(fds[gpio],GPIOHANDLE_GET_LINE_VALUES_IOCTL,&data) < 0 )
+        return -1;
+    return data.values[0] ? 1 : 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Poll all watched lines, then drain up to GPIOEVT_BATCH events from
+// each ready line with one read(2). Lines are merged by timestamp.
+//////////////////////////////////////////////////////////////////////
+
+int
+GPIOEvents::read(std::vector<s_event>& events,int timeout_ms) {
+    struct pollfd pfds[GPIO_MAX+1];
+    struct gpioevent_data buf[GPIOEVT_BATCH];
+    size_t n = watched.size(), first = events.size();
+    int rc;
+
+    if ( n < 1 ) {
+        errno = EINVAL;             // Nothing watched
+        return -1;
+    }
+
+    for ( size_t x = 0; x < n; ++x ) {
+        pfds[x].fd = fds[watched[x]];
+        pfds[x].events = POLLIN;
+        pfds[x].revents = 0;
+    }
+
+    do  {
+        rc = poll(pfds,n,timeout_ms);
+    } while ( rc < 0 && errno == EINTR );
+
+    if ( rc <= 0 )
+        return rc;                  // Timeout or error
+
+    for ( size_t x = 0; x < n; ++x ) {
+        if ( !(pfds[x].revents & POLLIN) )
+            continue;
+
+        ssize_t bytes = ::read(pfds[x].fd,buf,sizeof buf);
+
+        if ( bytes < 0 ) {
+            if ( errno == EAGAIN || errno == EINTR )
+                continue;
+            return -1;
+        }
+
+        for ( size_t ex = 0; ex < size_t(bytes) / sizeof buf[0]; ++ex ) {
+            s_event ev;
+
+            ev.timestamp_ns = buf[ex].timestamp;
+            ev.gpio = watched[x];
+            ev.level = buf[ex].id == GPIOEVENT_EVENT_RISING_EDGE ? 1 : 0;
+            events.push_back(ev);
+        }
+    }
+
+    std::stable_sort(events.begin()+first,events.end(),
+        [](const s_event& a,const s_event& b) { return a.timestamp_ns < b.timestamp_ns; });
+
+    return int(events.size() - first);
+}
+
+// End gpioevt.cpp
@@ -15,10 +15,10 @@
 #include <string.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <sys/poll.h>
 #include <assert.h>
 
-#include "dmamem.hpp"
 #include "gpio.hpp"
 #include "piutils.hpp"
 #include "rpidma.h"
@@ -31,11 +31,23 @@ LogicAnalyzer::LogicAnalyzer(unsigned arg_ppblk) : pagespblk(arg_ppblk) {
     pagesize = 0;
     fd = -1;
 
-    dalloc.slave_id = 0;        // No DREQ
-    dalloc.page_sz = 0;
-    dalloc.src_addr = 0;
-    dalloc.n_dst = 0;
-    dalloc.pdst_addr = nullptr;
+    ring.n_bufs = 0;
+    ring.buf_sz = 0;
+    ring.bus_addr = 0;
+    ring.size = 0;
+    ring_map = nullptr;
+
+    dreq = 0;
+    seg_first = seg_blocks = 0;
+    rate = 0.0;
+    stamps = false;
+    pace_chan = LOGANA_PACE_CHAN;
+    cb_fd = -1;
+    cb_ring.n_bufs = cb_ring.buf_sz = 0;
+    cb_ring.bus_addr = cb_ring.size = 0;
+    cb_map = nullptr;
+    dma = nullptr;
+    pacer = nullptr;
 }
 
 LogicAnalyzer::~LogicAnalyzer() {
@@ -52,22 +64,14 @@ LogicAnalyzer::open() {
     if ( fd >= 0 )
         close();
 
-    fd = ::open("/dev/rpidma4x",O_RDONLY);
+    fd = ::open("/dev/rpidma4x",O_RDWR);
     if ( fd < 0 ) {
         ss << strerror(errno) << ": Opening driver /dev/rpidma4x";
         errmsg = ss.str();
         return false;
     }
 
-    // Open mailbox interface:
-
-    if ( !dmamem.create(1) ) {
-        ss  << strerror(errno) << ": opening mailbox /dev/vcio";
-        errmsg = ss.str();
-        return false;
-    }
-
-    pagesize = dmamem.get_page_size();
+    pagesize = sys_page_size();
     sampspblk = ( ( pagesize * pagespblk ) / sizeof(uint32_t) );
 
     return true;
@@ -76,36 +80,102 @@ LogicAnalyzer::open() {
 void
 LogicAnalyzer::close() {
 
+    free_chain();
+    free_blocks();
+
     if ( fd >= 0 ) {
-        ::close(fd);
+        ::close(fd);                // Driver releases the ring
         fd = -1;
     }
+}
+
+//////////////////////////////////////////////////////////////////////
+// Stop the CB chain, and release its DMA channel and CB memory
+//////////////////////////////////////////////////////////////////////
+
+void
+LogicAnalyzer::free_chain() {
+
+    if ( dma ) {
+        dma->abort();
+        delete dma;
+        dma = nullptr;
+    }
+
+    if ( pacer ) {
+        delete pacer;               // Stops the PWM timebase
+        pacer = nullptr;
+    }
+
+    if ( cb_map ) {
+        munmap(cb_map,cb_ring.size);
+        cb_map = nullptr;
+    }
+
+    if ( cb_fd >= 0 ) {
+        ::close(cb_fd);             // Driver releases the CBs
+        cb_fd = -1;
+    }
+    cb_ring.n_bufs = cb_ring.size = 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Unmap the buffer ring, and have the driver release it
+//////////////////////////////////////////////////////////////////////
+
+void
+LogicAnalyzer::free_blocks() {
+
+    if ( ring_map ) {
+        munmap(ring_map,ring.size);
+        ring_map = nullptr;
+    }
+
+    if ( fd >= 0 && ring.n_bufs > 0 ) {
+        ring.n_bufs = 0;
+        ioctl(fd,RPIDMA_ALLOC,&ring);
+    }
 
+    ring.n_bufs = ring.size = 0;
     dma_blocks.clear();
-    sg_list.clear();
-    dmamem.close();
+    seg_first = seg_blocks = 0;
 }
 
+//////////////////////////////////////////////////////////////////////
+// Allocate DMA blocks: The driver allocates them as one contiguous,
+// DMA coherent ring, which is mapped here for zero-copy access.
+//////////////////////////////////////////////////////////////////////
+
 bool
 LogicAnalyzer::alloc_blocks(unsigned blocks) {
+    std::stringstream ss;
+
+    assert(fd >= 0);                // Driver must be open
+    free_blocks();
 
-    // Release existing blocks
-    for ( auto it = dma_blocks.begin(); it != dma_blocks.end(); ++it ) {
-	void *block = *it;
+    ring.n_bufs = blocks;
+    ring.buf_sz = pagesize * pagespblk;
 
-        dmamem.free(block);
+    if ( ioctl(fd,RPIDMA_ALLOC,&ring) != 0 ) {
+        ss << strerror(errno) << ": ioctl(RPIDMA_ALLOC)";
+        errmsg = ss.str();
+        ring.n_bufs = ring.size = 0;
+        return false;
     }
-    dma_blocks.clear();
 
-    sg_list.clear();
+    ring_map = mmap(nullptr,ring.size,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+    if ( ring_map == MAP_FAILED ) {
+        ss << strerror(errno) << ": mmap(/dev/rpidma4x)";
+        errmsg = ss.str();
+        ring_map = nullptr;
+        free_blocks();
+        return false;
+    }
 
     // Create the requested blocks
     dma_blocks.reserve(blocks);
-    for ( unsigned ux=0; ux < blocks; ++ux ) {
-        void *block = dmamem.allocate(pagespblk);
-        dma_blocks.push_back(block);
-        sg_list.push_back(dmamem.phys_addr(block));
-    }
+    for ( unsigned ux=0; ux < blocks; ++ux )
+        dma_blocks.push_back((uint8_t *)ring_map + ux * ring.buf_sz);
 
     return true;
 }
@@ -117,27 +187,81 @@ LogicAnalyzer::get_gplev0() {
     return phys + 0x0034; // GPLEV0
 }
 
+//////////////////////////////////////////////////////////////////////
+// Restrict following prepare()/start() calls to blocks first_block
+// .. first_block+n_blocks-1, so that several captures (segments) can
+// share the allocated blocks. set_segment(0,0) selects all blocks.
+//////////////////////////////////////////////////////////////////////
+
+bool
+LogicAnalyzer::set_segment(unsigned first_block,unsigned n_blocks) {
+
+    if ( n_blocks == 0 ) {
+        seg_first = seg_blocks = 0;
+        return true;
+    }
+
+    if ( first_block + n_blocks > dma_blocks.size() ) {
+        errmsg = "Segment exceeds allocated blocks";
+        return false;
+    }
+
+    seg_first = first_block;
+    seg_blocks = n_blocks == dma_blocks.size() ? 0 : n_blocks;
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Fill in a driver request for the ring (or the current segment)
+//////////////////////////////////////////////////////////////////////
+
+void
+LogicAnalyzer::set_ioctl(s_rpidma_ioctl& rpidma,unsigned long src_addr,std::vector<uint32_t>& dsts) {
+
+    rpidma.slave_id = dreq;
+    rpidma.page_sz = ring.buf_sz;       // Bytes
+    rpidma.src_addr = src_addr;
+    rpidma.n_dst = 0;                   // Use driver's buffer ring
+    rpidma.pdst_addr = nullptr;
+    rpidma.direction = RPIDMA_DEV_TO_MEM;
+
+    if ( seg_blocks > 0 ) {
+        dsts.clear();
+        for ( unsigned ux = 0; ux < seg_blocks; ++ux )
+            dsts.push_back(ring.bus_addr + ( seg_first + ux ) * ring.buf_sz);
+        rpidma.n_dst = seg_blocks;      // Part of the ring
+        rpidma.pdst_addr = dsts.data();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+// Set last 2 words in first block to a pattern that will be overwritten
+//////////////////////////////////////////////////////////////////////
+
+void
+LogicAnalyzer::mark_1stblock() {
+    uint32_t *uwords = (uint32_t *)dma_blocks[seg_first]; // Point to block of uint32_t words
+    uint32_t ux = ring.buf_sz / sizeof uwords[0];       // # of uint32_t words per block
+    
+    uwords[ux-2] = 0xA5A5A5A5;
+    uwords[ux-1] = ~uwords[ux-2];
+}
+
 bool
 LogicAnalyzer::start(unsigned long src_addr) {
+    std::vector<uint32_t> dsts;
     s_rpidma_ioctl rpidma;    
     int rc;
 
     assert(dma_blocks.size() >= 1); // Must have storage allocated
     assert(fd >= 0);                // Driver must be open
         
-    rpidma.slave_id = 0;
-    rpidma.page_sz = pagesize * sizeof(uint32_t);	// Bytes
-    rpidma.src_addr = src_addr;
-    
-    rpidma.n_dst = sg_list.size();
-    rpidma.pdst_addr = (uint32_t *)sg_list.data();
+    if ( chained() )
+        return prepare(src_addr) && restart();
+    free_chain();
 
-    uint32_t *uwords = (uint32_t *)dma_blocks[0];       // Point to block of uint32_t words
-    uint32_t ux = rpidma.page_sz / sizeof uwords[0];    // # of uint32_t words per block
-    
-    // Set last 2 words in first block to a pattern that will be overwritten
-    uwords[ux-2] = 0xA5A5A5A5;
-    uwords[ux-1] = ~uwords[ux-2];
+    set_ioctl(rpidma,src_addr,dsts);
+    mark_1stblock();
 
     // Light this candle!
     rc = ioctl(fd,RPIDMA_START,&rpidma);
@@ -146,12 +270,284 @@ LogicAnalyzer::start(unsigned long src_addr) {
     return true;
 }
 
+//////////////////////////////////////////////////////////////////////
+// Prepare the DMA once, without starting it. Each restart() then
+// re-arms it on the channel held by the driver, which is much faster
+// than start() when retrying for a trigger.
+//////////////////////////////////////////////////////////////////////
+
+bool
+LogicAnalyzer::prepare(unsigned long src_addr) {
+    std::vector<uint32_t> dsts;
+    s_rpidma_ioctl rpidma;    
+    std::stringstream ss;
+
+    assert(dma_blocks.size() >= 1); // Must have storage allocated
+    assert(fd >= 0);                // Driver must be open
+
+    if ( chained() )
+        return prepare_chain(src_addr);
+    free_chain();                   // Driver paced/free running
+
+    set_ioctl(rpidma,src_addr,dsts);
+
+    if ( ioctl(fd,RPIDMA_PREPARE,&rpidma) != 0 ) {
+        ss << strerror(errno) << ": ioctl(RPIDMA_PREPARE)";
+        errmsg = ss.str();
+        return false;
+    }
+
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Prepare a CB chain for paced and/or timestamped sampling:
+//
+// A DMA read of GPLEV0 drains no FIFO, so DREQ alone cannot pace it.
+// Instead each sample is a short run of CBs: With pacing, the first
+// writes a dummy word to the pacer's PWM FIFO (gated by its DREQ).
+// With timestamps, the next copies ST_CLO into the ring (the 2D
+// stride is only 16 bits, too short to reach from GPLEV0 to ST_CLO
+// in one CB). The last copies src_addr into the ring. The CBs live
+// in a second driver allocated (coherent) buffer, and run on a raw
+// DMA channel.
+//
+// The chain costs 64 bytes per 4 byte paced sample (16x), 64 per
+// 8 byte stamped sample (8x), or 96 when both (12x).
+//
+// One CB per burst of samples is not possible: The PWM DREQ only
+// drops when its FIFO is written, and a GPLEV0 read cannot write it,
+// so every sample needs its own pacing CB. Size the blocks with this
+// overhead in mind.
+//////////////////////////////////////////////////////////////////////
+
+bool
+LogicAnalyzer::prepare_chain(unsigned long src_addr) {
+    const uint32_t wps = stamps ? 2 : 1;            // Words per sample
+    const uint32_t cbps = wps + (rate > 0.0 ? 1 : 0); // CBs per sample
+    uint32_t samples = dma_blocks.size() * sampspblk / wps;
+    std::stringstream ss;
+    int rc;
+
+    free_chain();
+
+    if ( seg_blocks > 0 ) {
+        errmsg = "Segments are not supported with paced or timestamped sampling";
+        return false;
+    }
+
+    cb_fd = ::open("/dev/rpidma4x",O_RDWR);
+    if ( cb_fd < 0 ) {
+        ss << strerror(errno) << ": Opening driver /dev/rpidma4x";
+        errmsg = ss.str();
+        return false;
+    }
+
+    // cbps CBs per sample, plus one CB slot for the dummy word
+    cb_ring.n_bufs = 1;
+    cb_ring.buf_sz = (samples * cbps + 1) * sizeof(DMA::CB);
+    cb_ring.buf_sz = (cb_ring.buf_sz + pagesize - 1) / pagesize * pagesize;
+
+    if ( ioctl(cb_fd,RPIDMA_ALLOC,&cb_ring) != 0 ) {
+        ss << strerror(errno) << ": ioctl(RPIDMA_ALLOC) for "
+           << cb_ring.buf_sz << " bytes of CBs";
+        errmsg = ss.str();
+        free_chain();
+        return false;
+    }
+
+    cb_map = mmap(nullptr,cb_ring.size,PROT_READ|PROT_WRITE,MAP_SHARED,cb_fd,0);
+    if ( cb_map == MAP_FAILED ) {
+        ss << strerror(errno) << ": mmap(/dev/rpidma4x) for CBs";
+        errmsg = ss.str();
+        cb_map = nullptr;
+        free_chain();
+        return false;
+    }
+
+    dma = new DMA;
+    if ( dma->get_error() || !dma->set_channel(pace_chan) ) {
+        ss << strerror(dma->get_error() ? dma->get_error() : EINVAL)
+           << ": Opening DMA channel " << pace_chan;
+        errmsg = ss.str();
+        free_chain();
+        return false;
+    }
+
+    if ( rate > 0.0 ) {
+        pacer = new Pacer;
+        if ( (rc = pacer->start(rate)) != 0 ) {
+            ss << strerror(rc) << ": Starting PWM pacer at " << rate << " Hz";
+            errmsg = ss.str();
+            free_chain();
+            return false;
+        }
+        rate = pacer->get_rate();   // Rate actually achieved
+    }
+
+    DMA::CB *cbs = (DMA::CB *)cb_map;
+    const uint32_t n_cbs = samples * cbps;
+    const uint32_t cb_bus = cb_ring.bus_addr;
+    const uint32_t dummy_bus = cb_bus + n_cbs * sizeof(DMA::CB);
+    uint32_t cbx = 0;
+
+    cbs[n_cbs].clear();             // Dummy word (zero)
+
+    for ( uint32_t ux = 0; ux < samples; ++ux ) {
+        uint32_t dest = ring.bus_addr + ux * wps * sizeof(uint32_t);
+
+        if ( rate > 0.0 ) {
+            DMA::CB& pace = cbs[cbx++];
+
+            pace.clear();
+            pace.TI.NO_WIDE_BURSTS = 1;
+            pace.TI.WAIT_RESP = 1;
+            pace.TI.DEST_DREQ = 1;
+            pace.TI.PERMAP = Pacer::dreq();
+            pace.SOURCE_AD = dummy_bus;
+            pace.DEST_AD = Pacer::fifo_addr();
+            pace.TXFR_LEN = sizeof(uint32_t);
+            pace.NEXTCONBK = cb_bus + cbx * sizeof(DMA::CB);
+        }
+
+        if ( stamps ) {
+            DMA::CB& stamp = cbs[cbx++];
+
+            stamp.clear();
+            stamp.TI.NO_WIDE_BURSTS = 1;
+            stamp.TI.WAIT_RESP = 1;
+            stamp.SOURCE_AD = LOGANA_ST_CLO;
+            stamp.DEST_AD = dest;
+            stamp.TXFR_LEN = sizeof(uint32_t);
+            stamp.NEXTCONBK = cb_bus + cbx * sizeof(DMA::CB);
+            dest += sizeof(uint32_t);
+        }
+
+        DMA::CB& samp = cbs[cbx++];
+
+        samp.clear();
+        samp.TI.NO_WIDE_BURSTS = 1;
+        samp.TI.WAIT_RESP = 1;
+        samp.SOURCE_AD = uint32_t(src_addr);
+        samp.DEST_AD = dest;
+        samp.TXFR_LEN = sizeof(uint32_t);
+        samp.NEXTCONBK = cbx < n_cbs
+            ? cb_bus + cbx * sizeof(DMA::CB)
+            : 0;                    // Last sample ends the chain
+    }
+
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+// (Re)start the transfer set up by prepare() (or the last start())
+//////////////////////////////////////////////////////////////////////
+
+bool
+LogicAnalyzer::restart() {
+    std::stringstream ss;
+
+    assert(fd >= 0);                // Driver must be open
+
+    mark_1stblock();
+
+    if ( dma ) {
+        // Run the CB chain built by prepare_chain()
+        if ( !dma->start(cb_ring.bus_addr) ) {
+            errmsg = "Unable to start paced DMA channel";
+            return false;
+        }
+        return true;
+    }
+
+    if ( ioctl(fd,RPIDMA_RESTART,0) != 0 ) {
+        ss << strerror(errno) << ": ioctl(RPIDMA_RESTART)";
+        errmsg = ss.str();
+        return false;
+    }
+
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Start cyclic DMA: The blocks form a ring that the DMA refills
+// endlessly, one period per block, until cancel() is called.
+// Completed blocks are reported by next_period().
+//////////////////////////////////////////////////////////////////////
+
+bool
+LogicAnalyzer::start_cyclic(unsigned long src_addr) {
+    s_rpidma_ioctl rpidma;    
+    std::stringstream ss;
+
+    assert(dma_blocks.size() >= 2); // Must have a ring allocated
+    assert(fd >= 0);                // Driver must be open
+
+    if ( chained() ) {
+        errmsg = "Cyclic DMA is not supported with paced or timestamped sampling";
+        return false;
+    }
+
+    rpidma.slave_id = dreq;
+    rpidma.page_sz = ring.buf_sz;       // Bytes per period
+    rpidma.src_addr = src_addr;
+    rpidma.n_dst = 0;                   // Use driver's buffer ring
+    rpidma.pdst_addr = nullptr;
+    rpidma.direction = RPIDMA_DEV_TO_MEM;
+
+    if ( ioctl(fd,RPIDMA_CYCLIC,&rpidma) != 0 ) {
+        ss << strerror(errno) << ": ioctl(RPIDMA_CYCLIC)";
+        errmsg = ss.str();
+        return false;
+    }
+
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Wait for the next completed cyclic period (block):
+//
+// Returns 1 when period was filled in, 0 on timeout, or -1 on error.
+// period.index is the block # (see get_samples()) and period.overruns
+// counts the blocks overwritten before they could be read.
+//////////////////////////////////////////////////////////////////////
+
+int
+LogicAnalyzer::next_period(s_rpidma_period& period,int timeout_ms) {
+    struct pollfd pfd;
+    int rc;
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    do  {
+        rc = poll(&pfd,1,timeout_ms);
+    } while ( rc < 0 && errno == EINTR );
+
+    if ( rc <= 0 )
+        return rc < 0 ? -1 : 0;
+
+    rc = ::read(fd,&period,sizeof period);
+    if ( rc == sizeof period )
+        return 1;
+    if ( rc == 0 )
+        errno = ECANCELED;          // Cyclic DMA was stopped
+    return -1;
+}
+
 //////////////////////////////////////////////////////////////////////
 // Cancel current DMA operation (if any)
 //////////////////////////////////////////////////////////////////////
 
 void
 LogicAnalyzer::cancel() {
+
+    if ( dma ) {
+        dma->abort();
+        return;
+    }
+
     int rc = ioctl(fd,RPIDMA_CANCEL,0);
     assert(!rc);
 }
@@ -163,8 +559,8 @@ LogicAnalyzer::cancel() {
 bool
 LogicAnalyzer::read_1stblock() {
     assert(dma_blocks.size() >= 1);                                 // Must have storage allocated
-    volatile uint32_t *uwords = (volatile uint32_t *)dma_blocks[0]; // Point to block of uint32_t words
-    uint32_t blksiz = pagesize * sizeof(uint32_t);                  // Bytes
+    volatile uint32_t *uwords = (volatile uint32_t *)dma_blocks[seg_first]; // Point to block of uint32_t words
+    uint32_t blksiz = ring.buf_sz;                                  // Bytes
     uint32_t ux = blksiz / sizeof(uint32_t);                        // # of words
 
     return uwords[ux-2] != 0xA5A5A5A5 || uwords[ux-1] != ~0xA5A5A5A5;
@@ -177,9 +573,75 @@ LogicAnalyzer::read_1stblock() {
 int
 LogicAnalyzer::is_completed() {
 
+    if ( dma ) {
+        if ( dma->is_error() )
+            return -EIO;
+        return dma->is_ended() ? 1 : 0;
+    }
+
     return ioctl(fd,RPIDMA_STATUS,0);
 }
 
+//////////////////////////////////////////////////////////////////////
+// Return the sample period (ns) of the last completed capture:
+//
+// Paced captures run at the pacer's (crystal derived) rate, and
+// timestamped captures use their first and last stamps. Free running
+// captures are timed by the driver, from submission to completion,
+// so that the period tracks the actual DMA throughput.
+// Returns 0.0 (and sets error()) if the period is not known.
+//////////////////////////////////////////////////////////////////////
+
+double
+LogicAnalyzer::sample_period() {
+    s_rpidma_timing timing;
+    std::stringstream ss;
+
+    if ( dma ) {
+        size_t n = 0;
+        s_logana_stamp *sp = rate > 0.0 ? nullptr : get_stamps(&n);
+
+        if ( rate > 0.0 )
+            return 1e9 / rate;
+        if ( !sp || n < 2 ) {
+            errmsg = "No timestamps captured";
+            return 0.0;
+        }
+        return ( sp[n-1].st_clo - sp[0].st_clo ) * 1000.0 / ( n - 1 );
+    }
+
+    if ( ioctl(fd,RPIDMA_TIMING,&timing) != 0 ) {
+        ss << strerror(errno) << ": ioctl(RPIDMA_TIMING)";
+        errmsg = ss.str();
+        return 0.0;
+    }
+
+    if ( timing.bytes < sizeof(uint32_t) ) {
+        errmsg = "No samples were timed";
+        return 0.0;
+    }
+
+    return double(timing.elapsed_ns) / (timing.bytes / sizeof(uint32_t));
+}
+
+//////////////////////////////////////////////////////////////////////
+// Fetch the driver's transfer counters: For this open file, or for
+// all users of the driver (global). CB chain captures are not run by
+// the driver, and so are not counted.
+//////////////////////////////////////////////////////////////////////
+
+bool
+LogicAnalyzer::driver_stats(s_rpidma_stats& stats,bool global) {
+    std::stringstream ss;
+
+    if ( ioctl(fd,global ? RPIDMA_GSTATS : RPIDMA_STATS,&stats) != 0 ) {
+        ss << strerror(errno) << ": ioctl(" << ( global ? "RPIDMA_GSTATS" : "RPIDMA_STATS" ) << ")";
+        errmsg = ss.str();
+        return false;
+    }
+    return true;
+}
+
 uint32_t *
 LogicAnalyzer::get_samples(unsigned blockx,size_t *n_samples) {
 
@@ -193,4 +655,202 @@ LogicAnalyzer::get_samples(unsigned blockx,size_t *n_samples) {
     return (uint32_t *)dma_blocks[blockx];
 }
 
+//////////////////////////////////////////////////////////////////////
+// Append the completed capture (all blocks) to rle. For cyclic DMA,
+// append each block as next_period() reports it instead:
+//
+//      rle.append(get_samples(period.index,&n),n);
+//////////////////////////////////////////////////////////////////////
+
+bool
+LogicAnalyzer::encode(RLECapture& rle) {
+    size_t n;
+
+    if ( stamps ) {
+        errmsg = "Timestamped captures are not run-length encoded";
+        return false;
+    }
+
+    for ( unsigned ux = 0; ux < dma_blocks.size(); ++ux ) {
+        uint32_t *samples = get_samples(ux,&n);
+
+        rle.append(samples,n);
+    }
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Build the per-channel edge index of the completed capture
+//////////////////////////////////////////////////////////////////////
+
+bool
+LogicAnalyzer::index(EdgeIndex& idx,unsigned threads) {
+    std::vector<const uint32_t*> blocks;
+
+    if ( stamps ) {
+        errmsg = "Timestamped captures are not edge indexed";
+        return false;
+    }
+
+    for ( void *block : dma_blocks )
+        blocks.push_back((const uint32_t *)block);
+    idx.build(blocks,sampspblk,threads);
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Compute per-channel statistics of the completed capture
+//////////////////////////////////////////////////////////////////////
+
+bool
+LogicAnalyzer::statistics(SignalStats& stats) {
+    size_t n;
+
+    if ( stamps ) {
+        errmsg = "Statistics are not supported for timestamped captures";
+        return false;
+    }
+
+    stats.clear();
+    for ( unsigned ux = 0; ux < dma_blocks.size(); ++ux ) {
+        uint32_t *samples = get_samples(ux,&n);
+
+        stats.feed(samples,n);
+    }
+    stats.finish();
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Build the multi-resolution summary of the capture
+//////////////////////////////////////////////////////////////////////
+
+bool
+LogicAnalyzer::summarize(SummaryPyramid& pyr) {
+    size_t n;
+
+    if ( stamps ) {
+        errmsg = "Summaries are not supported for timestamped captures";
+        return false;
+    }
+
+    pyr.clear();
+    for ( unsigned ux = 0; ux < dma_blocks.size(); ++ux ) {
+        uint32_t *samples = get_samples(ux,&n);
+
+        pyr.feed(samples,n);
+    }
+    pyr.finish();
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Write the capture blocks as a raw capture file (see capcmp)
+//////////////////////////////////////////////////////////////////////
+
+bool
+LogicAnalyzer::save_raw(const char *path,uint64_t trigger) {
+    std::vector<const uint32_t*> blocks;
+    size_t n = 0;
+    int er;
+
+    if ( stamps ) {
+        errmsg = "Raw files are not supported for timestamped captures";
+        return false;
+    }
+
+    for ( unsigned ux = 0; ux < dma_blocks.size(); ++ux )
+        blocks.push_back(get_samples(ux,&n));
+
+    if ( (er = RawCapture::write(path,blocks,n,sample_period(),trigger)) != 0 ) {
+        std::stringstream ss;
+
+        ss << strerror(er) << ": writing " << path;
+        errmsg = ss.str();
+        return false;
+    }
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Return all timestamped samples (set_timestamps(true)) of the
+// capture, in time order (the blocks are contiguous).
+//////////////////////////////////////////////////////////////////////
+
+s_logana_stamp *
+LogicAnalyzer::get_stamps(size_t *n_stamps) {
+
+    if ( n_stamps )
+        *n_stamps = 0;
+
+    if ( !stamps || !ring_map )
+        return nullptr;
+
+    if ( n_stamps )
+        *n_stamps = dma_blocks.size() * sampspblk / 2;
+    return (s_logana_stamp *)ring_map;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Compute the time (ns) of each timestamped sample, relative to the
+// first. ST_CLO only counts microseconds, so samples sharing a tick
+// are spread evenly across it. A tick that advances by more than one
+// usec is a DMA stall: Its samples keep the nominal period, leaving
+// the stall as a visible gap in the timeline.
+//////////////////////////////////////////////////////////////////////
+
+bool
+LogicAnalyzer::sample_times(std::vector<double>& t_ns) {
+    size_t n = 0, x, y, ticks = 0, tick_samps = 0;
+    s_logana_stamp *sp = get_stamps(&n);
+
+    t_ns.clear();
+    if ( !sp || n < 1 ) {
+        errmsg = "No timestamps captured";
+        return false;
+    }
+
+    // Nominal period from intervals spanning exactly one tick
+    for ( x = 0, y = 1; y < n; ++y ) {
+        if ( sp[y].st_clo == sp[x].st_clo )
+            continue;
+        if ( sp[y].st_clo - sp[x].st_clo == 1 && x > 0 ) {
+            ++ticks;
+            tick_samps += y - x;
+        }
+        x = y;
+    }
+
+    double nominal = ticks > 0 ? 1000.0 * ticks / tick_samps
+        : ( n > 1 ? ( sp[n-1].st_clo - sp[0].st_clo ) * 1000.0 / ( n - 1 ) : 0.0 );
+
+    t_ns.resize(n);
+
+    for ( x = 0; x < n; x = y ) {
+        uint32_t dt;
+
+        for ( y = x + 1; y < n && sp[y].st_clo == sp[x].st_clo; ++y )
+            ;
+
+        dt = y < n ? sp[y].st_clo - sp[x].st_clo : 1;
+
+        double per = dt == 1 && y < n ? 1000.0 / ( y - x ) : nominal;
+        double t0 = ( sp[x].st_clo - sp[0].st_clo ) * 1000.0;
+
+        if ( x == 0 && y < n ) {
+            // The capture began part way into its first tick
+            per = nominal;
+            t0 = dt * 1000.0 - y * per;
+        }
+
+        for ( size_t z = x; z < y; ++z )
+            t_ns[z] = t0 + ( z - x ) * per;
+    }
+
+    for ( x = n; x-- > 0; )
+        t_ns[x] -= t_ns[0];        // Relative to the first sample
+
+    return true;
+}
+
 // End logana.cpp
@@ -27,19 +27,29 @@ MAX7219::MAX7219(int clk,int din,int load) {
     pin_din = din;          // GPIO pin for DIN
     pin_load = load;        // GPIO pin for LOAD
 
+    m_clk = m_din = m_load = 0;
+
     decodes = 0b000000000;  // Assume no decodes
     duty_cfg = 15;          // 50% brightness
     N = 8;                  // 8 rows (digits)
 
+    if ( clk < 0 || clk > GPIO_MAX || din < 0 || din > GPIO_MAX
+      || load < 0 || load > GPIO_MAX ) {
+        errcode = EINVAL;   // Invalid pin
+        return;
+    }
+
+    m_clk = uint64_t(1) << clk;
+    m_din = uint64_t(1) << din;
+    m_load = uint64_t(1) << load;
+
     errcode = gpio.configure(pin_clk,GPIO::Output);
     if ( errcode )
         return;             // GPIO failed to open
 
     gpio.configure(pin_din,GPIO::Output);
     gpio.configure(pin_load,GPIO::Output);
-    gpio.write(pin_clk,0);
-    gpio.write(pin_din,1);
-    gpio.write(pin_load,0);
+    gpio.write_mask(m_din,m_clk|m_load);
 
     tCH = 50;               // ns
     tCL = 50;
@@ -54,13 +64,14 @@ MAX7219::wrbit(int b,int last) {
     if ( errcode )
         return errcode;     // GPIO open failure
 
-    gpio.write(pin_din,b);  // Set state of DIN
+    if ( b )                // Set state of DIN
+        gpio.write_mask(m_din,0);
+    else
+        gpio.write_mask(0,m_din);
     nswait(tDS+1);          // Wait min setup time
-    gpio.write(pin_clk,1);  // Set clock high
-    if ( last )
-        gpio.write(pin_load,1);
+    gpio.write_mask(last ? m_clk|m_load : m_clk,0); // CLK (and LOAD) high
     nswait(Max(tDS,tCH));   // DIN setup & CLK high
-    gpio.write(pin_clk,0);  // set CLK low
+    gpio.write_mask(0,m_clk); // set CLK low
     nswait(tCL);            // wait out CLK low
     return 0;
 }
@@ -71,7 +82,7 @@ MAX7219::write(unsigned cmd16) {
     if ( errcode )
         return errcode;     // GPIO open failure
 
-    gpio.write(pin_load,0);
+    gpio.write_mask(0,m_load);
     
     for ( unsigned bx=16; bx-- > 0; )
         wrbit((cmd16 >> bx) & 1,!bx);
@@ -0,0 +1,81 @@
+//////////////////////////////////////////////////////////////////////
+// pacer.cpp -- DMA Pacer Class Implementation
+//
+// The PWM peripheral, run as a serializer fed from its FIFO, consumes
+// one FIFO word every RNG1 PWM clocks. With PWM DMA requests enabled,
+// DREQ 5 is only asserted when a word has been consumed, providing a
+// stable timebase for DMA control block chains.
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#include <errno.h>
+#include <math.h>
+
+#include "pacer.hpp"
+
+Pacer::Pacer() {
+    rate = 0.0;
+}
+
+Pacer::~Pacer() {
+    stop();
+}
+
+//////////////////////////////////////////////////////////////////////
+// Start pacing at rate_hz: Returns 0 or an errno value. The rate
+// achieved (PACER_CLOCK / RNG1) is returned by get_rate().
+//////////////////////////////////////////////////////////////////////
+
+int
+Pacer::start(double rate_hz) {
+    int rc;
+
+    if ( gpio.get_error() )
+        return gpio.get_error();
+
+    if ( rate_hz <= 0.0 || rate_hz > PACER_CLOCK / 2 )
+        return EINVAL;
+
+    double range = floor(PACER_CLOCK / rate_hz + 0.5);
+    if ( range > 4294967295.0 )
+        return EINVAL;              // Too slow for RNG1
+
+    stop();
+
+    rc = gpio.start_clock(PACER_GPIO,GPIO::PLLD,PACER_DIVI,0,0,false);
+    if ( rc )
+        return rc;
+
+    rc = gpio.pwm_configure(PACER_GPIO,GPIO::Serialize,false,0,false,true,GPIO::PwmAlgorithm);
+    if ( !rc )
+        rc = gpio.pwm_ratio(PACER_GPIO,0,uint32_t(range));
+    if ( !rc )
+        rc = gpio.pwm_dma(PACER_GPIO,true);
+    if ( !rc )
+        rc = gpio.pwm_enable(PACER_GPIO,true);
+
+    if ( rc ) {
+        gpio.stop_clock(PACER_GPIO);
+        return rc;
+    }
+
+    rate = PACER_CLOCK / range;
+    return 0;
+}
+
+void
+Pacer::stop() {
+
+    if ( rate <= 0.0 )
+        return;
+
+    gpio.pwm_dma(PACER_GPIO,false);
+    gpio.pwm_enable(PACER_GPIO,false);
+    gpio.stop_clock(PACER_GPIO);
+    rate = 0.0;
+}
+
+// End pacer.cpp
@@ -0,0 +1,222 @@
+//////////////////////////////////////////////////////////////////////
+// patgen.cpp -- DMA Pattern Generator Implementation
+//
+// The driver's buffer ring is filled through mmap(2), then streamed
+// by the driver (RPIDMA_MEM_TO_DEV) to one peripheral register, one
+// word per DREQ. For example, with a Pacer running, set_dreq(
+// Pacer::dreq()) and start(Pacer::fifo_addr()) shift each word out of
+// the PWM0 serializer, at the pacer's rate, without the CPU.
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/poll.h>
+#include <assert.h>
+
+#include "patgen.hpp"
+
+#include <sstream>
+
+PatternGen::PatternGen() {
+    fd = -1;
+    ring.n_bufs = ring.buf_sz = 0;
+    ring.bus_addr = ring.size = 0;
+    ring_map = nullptr;
+    dreq = 0;
+}
+
+PatternGen::~PatternGen() {
+    close();
+}
+
+bool
+PatternGen::open() {
+    std::stringstream ss;
+
+    if ( fd >= 0 )
+        close();
+
+    fd = ::open(RPIDMA_DEVICE_PATH,O_RDWR);
+    if ( fd < 0 ) {
+        ss << strerror(errno) << ": Opening driver " << RPIDMA_DEVICE_PATH;
+        errmsg = ss.str();
+        return false;
+    }
+    return true;
+}
+
+void
+PatternGen::close() {
+
+    free_buffers();
+
+    if ( fd >= 0 ) {
+        ::close(fd);                // Driver releases the ring
+        fd = -1;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+// Allocate n_bufs buffers of buf_sz bytes as the driver's ring
+//////////////////////////////////////////////////////////////////////
+
+bool
+PatternGen::alloc_buffers(unsigned n_bufs,uint32_t buf_sz) {
+    std::stringstream ss;
+
+    assert(fd >= 0);                // Driver must be open
+    free_buffers();
+
+    ring.n_bufs = n_bufs;
+    ring.buf_sz = buf_sz;
+
+    if ( ioctl(fd,RPIDMA_ALLOC,&ring) != 0 ) {
+        ss << strerror(errno) << ": ioctl(RPIDMA_ALLOC)";
+        errmsg = ss.str();
+        ring.n_bufs = ring.size = 0;
+        return false;
+    }
+
+    ring_map = mmap(nullptr,ring.size,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+    if ( ring_map == MAP_FAILED ) {
+        ss << strerror(errno) << ": mmap(" << RPIDMA_DEVICE_PATH << ")";
+        errmsg = ss.str();
+        ring_map = nullptr;
+        free_buffers();
+        return false;
+    }
+    return true;
+}
+
+void
+PatternGen::free_buffers() {
+
+    if ( ring_map ) {
+        munmap(ring_map,ring.size);
+        ring_map = nullptr;
+    }
+
+    if ( fd >= 0 && ring.n_bufs > 0 ) {
+        ring.n_bufs = 0;
+        ioctl(fd,RPIDMA_ALLOC,&ring);
+    }
+    ring.n_bufs = ring.size = 0;
+}
+
+uint32_t *
+PatternGen::get_buffer(unsigned bufx,size_t *n_words) {
+
+    if ( n_words )
+        *n_words = 0;
+
+    if ( !ring_map || bufx >= ring.n_bufs )
+        return nullptr;
+
+    if ( n_words )
+        *n_words = ring.buf_sz / sizeof(uint32_t);
+    return (uint32_t *)((uint8_t *)ring_map + bufx * ring.buf_sz);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Have the driver stream the whole ring to dev_addr
+//////////////////////////////////////////////////////////////////////
+
+bool
+PatternGen::request(int cmd,uint32_t dev_addr) {
+    s_rpidma_ioctl rpidma;
+    std::stringstream ss;
+
+    assert(fd >= 0);                // Driver must be open
+
+    if ( ring.n_bufs < 1 ) {
+        errmsg = "No pattern buffers allocated";
+        return false;
+    }
+
+    rpidma.slave_id = dreq;
+    rpidma.page_sz = ring.buf_sz;       // Bytes
+    rpidma.src_addr = dev_addr;         // Written, for MEM_TO_DEV
+    rpidma.n_dst = 0;                   // Use driver's buffer ring
+    rpidma.pdst_addr = nullptr;
+    rpidma.direction = RPIDMA_MEM_TO_DEV;
+
+    if ( ioctl(fd,cmd,&rpidma) != 0 ) {
+        ss << strerror(errno) << ": ioctl("
+           << ( cmd == RPIDMA_CYCLIC ? "RPIDMA_CYCLIC" : "RPIDMA_START" ) << ")";
+        errmsg = ss.str();
+        return false;
+    }
+    return true;
+}
+
+bool
+PatternGen::start(uint32_t dev_addr) {
+    return request(RPIDMA_START,dev_addr);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Repeat the ring until cancel(): next_period() reports each buffer
+// as it is sent, so that it can be refilled for streaming.
+//////////////////////////////////////////////////////////////////////
+
+bool
+PatternGen::start_cyclic(uint32_t dev_addr) {
+
+    if ( ring.n_bufs < 2 ) {
+        errmsg = "Cyclic patterns need 2 or more buffers";
+        return false;
+    }
+    return request(RPIDMA_CYCLIC,dev_addr);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Wait for the next sent cyclic period (buffer): Returns 1 when
+// period was filled in, 0 on timeout, or -1 on error.
+//////////////////////////////////////////////////////////////////////
+
+int
+PatternGen::next_period(s_rpidma_period& period,int timeout_ms) {
+    struct pollfd pfd;
+    int rc;
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    do  {
+        rc = poll(&pfd,1,timeout_ms);
+    } while ( rc < 0 && errno == EINTR );
+
+    if ( rc <= 0 )
+        return rc < 0 ? -1 : 0;
+
+    rc = ::read(fd,&period,sizeof period);
+    if ( rc == sizeof period )
+        return 1;
+    if ( rc == 0 )
+        errno = ECANCELED;          // Cyclic DMA was stopped
+    return -1;
+}
+
+int
+PatternGen::is_completed() {
+    return ioctl(fd,RPIDMA_STATUS,0);
+}
+
+void
+PatternGen::cancel() {
+
+    if ( fd >= 0 )
+        ioctl(fd,RPIDMA_CANCEL,0);
+}
+
+// End patgen.cpp
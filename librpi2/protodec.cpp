@@ -0,0 +1,395 @@
+//////////////////////////////////////////////////////////////////////
+// protodec.cpp -- UART, SPI and I2C Decoders Implementation
+//
+// The decoders walk an EdgeIndex rather than the raw samples, so idle
+// stretches of a capture cost nothing. SPI transactions are delimited
+// by CS, and are decoded in parallel.
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include <assert.h>
+
+#include <algorithm>
+#include <thread>
+
+#include "protodec.hpp"
+
+//////////////////////////////////////////////////////////////////////
+// Estimate the UART bit time (in samples) from the pulse widths on
+// rx: The narrowest pulse is taken as one bit, then all pulses up to
+// 9 bits wide are averaged by their bit count.
+// Returns 0.0 if there are too few edges.
+//////////////////////////////////////////////////////////////////////
+
+double
+ProtoDecoder::uart_autobaud(const EdgeIndex& idx,unsigned rx) {
+    const uint32_t *ep = 0;
+    size_t n = idx.edges(rx,0,idx.get_samples(),&ep);
+    uint32_t w_min = ~0u;
+    double sum = 0.0, bits = 0.0;
+
+    if ( n < 3 )
+        return 0.0;
+
+    for ( size_t x = 1; x < n; ++x )
+        w_min = std::min(w_min,ep[x] - ep[x-1]);
+
+    for ( size_t x = 1; x < n; ++x ) {
+        uint32_t w = ep[x] - ep[x-1];
+        double nbits = floor(double(w) / w_min + 0.5);
+
+        if ( nbits <= 9.0 ) {
+            sum += w;
+            bits += nbits;
+        }
+    }
+
+    return bits > 0.0 ? sum / bits : 0.0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Decode 8N1 UART frames on rx: Each falling edge is a start bit,
+// and the bits are sampled at their centres. The search for the next
+// start bit resumes from the centre of the stop bit.
+//////////////////////////////////////////////////////////////////////
+
+size_t
+ProtoDecoder::uart(const EdgeIndex& idx,unsigned rx,double bit_samples,std::vector<s_frame>& frames) {
+    const uint32_t n_samples = idx.get_samples();
+    const uint32_t *ep = 0, *base = 0;
+    size_t n, x, count = 0;
+
+    if ( bit_samples <= 0.0 )
+        bit_samples = uart_autobaud(idx,rx);
+    if ( bit_samples < 1.0 )
+        return 0;                   // Too fast for the capture
+
+    n = idx.edges(rx,0,n_samples,&base);
+
+    for ( x = 0; x < n; ) {
+        uint32_t start = base[x];
+        s_frame frame;
+
+        if ( idx.level(rx,start) != 0 ) {
+            ++x;                    // Rising edge: Not a start bit
+            continue;
+        }
+
+        double stop_c = start + 9.5 * bit_samples;
+        if ( stop_c >= n_samples )
+            break;                  // Frame runs off the capture
+
+        frame.start = start;
+        frame.end = uint32_t(start + 10.0 * bit_samples);
+        frame.kind = UART_Byte;
+        frame.data = frame.data2 = 0;
+        frame.flags = 0;
+
+        for ( unsigned bx = 0; bx < 8; ++bx ) {
+            uint32_t c = uint32_t(start + ( bx + 1.5 ) * bit_samples);
+
+            frame.data |= unsigned(idx.level(rx,c)) << bx;  // LSB first
+        }
+
+        if ( idx.level(rx,uint32_t(stop_c)) == 0 )
+            frame.flags |= FramingErr;
+
+        frames.push_back(frame);
+        ++count;
+
+        // Resume at the first edge from the stop bit centre
+        idx.edges(rx,uint32_t(stop_c),n_samples,&ep);
+        if ( !ep )
+            break;
+        x = ep - base;
+    }
+
+    return count;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Decode one SPI transaction (samples from .. to-1)
+//////////////////////////////////////////////////////////////////////
+
+static void
+spi_transaction(
+  const EdgeIndex& idx,
+  uint32_t from,
+  uint32_t to,
+  unsigned sck,
+  int mosi,
+  int miso,
+  unsigned mode,
+  unsigned bits,
+  std::vector<ProtoDecoder::s_frame>& frames) {
+    const int sample_level = ( mode == 0 || mode == 3 ) ? 1 : 0;
+    const uint32_t *ep = 0;
+    size_t n = idx.edges(sck,from,to,&ep);
+    ProtoDecoder::s_frame frame;
+    unsigned bx = 0;
+
+    frame.kind = ProtoDecoder::SPI_Word;
+    frame.flags = 0;
+    frame.data = frame.data2 = 0;
+    frame.start = from;
+
+    for ( size_t x = 0; x < n; ++x ) {
+        uint32_t e = ep[x];
+
+        if ( idx.level(sck,e) != sample_level )
+            continue;               // Not a sampling edge
+
+        if ( bx == 0 ) {
+            frame.start = e;
+            frame.data = frame.data2 = 0;
+        }
+
+        frame.data = ( frame.data << 1 ) | ( mosi >= 0 ? idx.level(mosi,e) : 0 );
+        frame.data2 = ( frame.data2 << 1 ) | ( miso >= 0 ? idx.level(miso,e) : 0 );
+
+        if ( ++bx >= bits ) {
+            frame.end = e + 1;
+            frame.flags = 0;
+            frames.push_back(frame);
+            bx = 0;
+        }
+    }
+
+    if ( bx > 0 ) {
+        frame.end = to;
+        frame.flags = ProtoDecoder::Partial;
+        frames.push_back(frame);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+// Decode SPI: Each CS low period (or the whole capture if cs < 0) is
+// an independent transaction, so transactions are shared out amongst
+// threads and their frames concatenated in order.
+//////////////////////////////////////////////////////////////////////
+
+size_t
+ProtoDecoder::spi(
+  const EdgeIndex& idx,
+  int cs,
+  unsigned sck,
+  int mosi,
+  int miso,
+  unsigned mode,
+  std::vector<s_frame>& frames,
+  unsigned bits,
+  unsigned threads) {
+    const uint32_t n_samples = idx.get_samples();
+    std::vector<std::pair<uint32_t,uint32_t> > trans;
+    size_t before = frames.size();
+
+    if ( mode > 3 || bits < 1 || bits > 32 )
+        return 0;
+
+    if ( cs < 0 ) {
+        trans.push_back(std::make_pair(0u,n_samples));
+    } else  {
+        const uint32_t *ep = 0;
+        size_t n = idx.edges(cs,0,n_samples,&ep);
+        uint32_t from = 0;
+        bool active = idx.level(cs,0) == 0;
+
+        for ( size_t x = 0; x < n; ++x ) {
+            if ( idx.level(cs,ep[x]) == 0 ) {
+                from = ep[x];       // CS asserted
+                active = true;
+            } else if ( active ) {
+                trans.push_back(std::make_pair(from,ep[x]));
+                active = false;
+            }
+        }
+        if ( active )
+            trans.push_back(std::make_pair(from,n_samples));
+    }
+
+    if ( trans.empty() )
+        return 0;
+
+    if ( threads == 0 )
+        threads = std::max(1u,std::thread::hardware_concurrency());
+    if ( threads > trans.size() )
+        threads = unsigned(trans.size());
+
+    std::vector<std::vector<s_frame> > results(trans.size());
+    std::vector<std::thread> workers;
+
+    auto worker = [&](unsigned tx) {
+        for ( size_t x = tx; x < trans.size(); x += threads )
+            spi_transaction(idx,trans[x].first,trans[x].second,sck,mosi,miso,mode,bits,results[x]);
+    };
+
+    for ( unsigned tx = 1; tx < threads; ++tx )
+        workers.push_back(std::thread(worker,tx));
+    worker(0);
+    for ( auto& thread : workers )
+        thread.join();
+
+    for ( auto& result : results )
+        frames.insert(frames.end(),result.begin(),result.end());
+
+    return frames.size() - before;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Decode I2C: The SCL and SDA edges are merged in time order. SDA
+// changing while SCL is high is a start (falling) or stop (rising).
+// Otherwise SDA is sampled on each SCL rising edge, 8 data bits and
+// then the ACK bit.
+//////////////////////////////////////////////////////////////////////
+
+size_t
+ProtoDecoder::i2c(const EdgeIndex& idx,unsigned scl,unsigned sda,std::vector<s_frame>& frames) {
+    const uint32_t n_samples = idx.get_samples();
+    const uint32_t *scl_ep = 0, *sda_ep = 0;
+    size_t n_scl = idx.edges(scl,0,n_samples,&scl_ep);
+    size_t n_sda = idx.edges(sda,0,n_samples,&sda_ep);
+    size_t xc = 0, xd = 0, before = frames.size();
+    bool in_frame = false, first = false;
+    unsigned bx = 0;
+    s_frame frame;
+
+    frame.data = frame.data2 = 0;
+    frame.flags = 0;
+    frame.start = frame.end = 0;
+
+    while ( xc < n_scl || xd < n_sda ) {
+        // Take SCL first, when both change together
+        bool is_scl = xd >= n_sda || ( xc < n_scl && scl_ep[xc] <= sda_ep[xd] );
+        uint32_t e = is_scl ? scl_ep[xc++] : sda_ep[xd++];
+
+        if ( !is_scl ) {
+            if ( !idx.level(scl,e) )
+                continue;           // Data change while SCL low
+            if ( xc > 0 && scl_ep[xc-1] == e )
+                continue;           // SCL changed too: Not a condition
+
+            s_frame cond;
+
+            cond.start = e;
+            cond.end = e + 1;
+            cond.data = cond.data2 = 0;
+            cond.flags = 0;
+
+            if ( idx.level(sda,e) == 0 ) {
+                cond.kind = I2C_Start;
+                in_frame = first = true;
+            } else  {
+                cond.kind = I2C_Stop;
+                in_frame = false;
+            }
+            frames.push_back(cond);
+            bx = 0;
+            continue;
+        }
+
+        if ( !in_frame || !idx.level(scl,e) )
+            continue;               // Only sample on SCL rising
+
+        unsigned bit = unsigned(idx.level(sda,e));
+
+        if ( bx == 0 ) {
+            frame.start = e;
+            frame.data = 0;
+        }
+
+        if ( bx < 8 ) {
+            frame.data = ( frame.data << 1 ) | bit;
+            ++bx;
+            continue;
+        }
+
+        // 9th bit: ACK (low) or NAK (high)
+        frame.kind = I2C_Byte;
+        frame.end = e + 1;
+        frame.flags = bit ? 0 : Ack;
+        if ( first ) {
+            frame.flags |= Address;
+            if ( frame.data & 1 )
+                frame.flags |= Read;
+            first = false;
+        }
+        frames.push_back(frame);
+        bx = 0;
+    }
+
+    return frames.size() - before;
+}
+
+const char *
+ProtoDecoder::kind_name(Kind kind) {
+
+    switch ( kind ) {
+    case UART_Byte:
+        return "uart";
+    case SPI_Word:
+        return "spi";
+    case I2C_Start:
+        return "i2c-start";
+    case I2C_Stop:
+        return "i2c-stop";
+    case I2C_Byte:
+        return "i2c";
+    default:
+        ;
+    }
+    return "?";
+}
+
+//////////////////////////////////////////////////////////////////////
+// Report frames: Times are in usec from the start of the capture
+//////////////////////////////////////////////////////////////////////
+
+void
+ProtoDecoder::write(FILE *outf,const std::vector<s_frame>& frames,double period_ns,bool csv) {
+
+    if ( csv )
+        fputs("start_us,end_us,kind,data,data2,flags\n",outf);
+
+    for ( const s_frame& frame : frames ) {
+        double t0 = frame.start * period_ns / 1000.0;
+        double t1 = frame.end * period_ns / 1000.0;
+        char flags[64];
+
+        snprintf(flags,sizeof flags,"%s%s%s%s%s",
+            frame.flags & FramingErr ? " framing-error" : "",
+            frame.flags & Address ? " address" : "",
+            frame.flags & Read ? " read" : "",
+            frame.kind == I2C_Byte ? ( frame.flags & Ack ? " ack" : " nak" ) : "",
+            frame.flags & Partial ? " partial" : "");
+
+        if ( csv ) {
+            fprintf(outf,"%.3f,%.3f,%s,0x%02X,0x%02X,%s\n",
+                t0,t1,kind_name(frame.kind),
+                frame.data,frame.data2,
+                flags[0] ? flags + 1 : "");
+            continue;
+        }
+
+        switch ( frame.kind ) {
+        case I2C_Start:
+        case I2C_Stop:
+            fprintf(outf,"%12.3f us  %s\n",t0,kind_name(frame.kind));
+            break;
+        case SPI_Word:
+            fprintf(outf,"%12.3f us  %-9s mosi 0x%02X miso 0x%02X%s\n",
+                t0,kind_name(frame.kind),frame.data,frame.data2,flags);
+            break;
+        default:
+            fprintf(outf,"%12.3f us  %-9s 0x%02X '%c'%s\n",
+                t0,kind_name(frame.kind),frame.data,
+                frame.data >= 0x20 && frame.data < 0x7F ? char(frame.data) : '.',
+                flags);
+        }
+    }
+}
+
+// End protodec.cpp
@@ -0,0 +1,106 @@
+//////////////////////////////////////////////////////////////////////
+// rawcap.cpp -- Raw Capture File Implementation
+//
+// A 32 byte header followed by the sample words in host byte order,
+// so a capture is written straight from the DMA blocks and read back
+// with one fread().
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+
+#include "rawcap.hpp"
+
+static const char rawcap_magic[8] = { 'R','P','I','2','C','A','P','1' };
+
+struct s_rawcap_hdr {
+    char        magic[8];
+    double      period_ns;          // ns per sample
+    uint64_t    n_samples;          // Sample words that follow
+    uint64_t    trigger;            // Trigger sample or RAWCAP_NO_TRIGGER
+};
+
+RawCapture::RawCapture() {
+    clear();
+}
+
+void
+RawCapture::clear() {
+    samples.clear();
+    period_ns = 0.0;
+    trigger = RAWCAP_NO_TRIGGER;
+}
+
+int
+RawCapture::write(const char *path,const std::vector<const uint32_t*>& blocks,size_t samps,
+  double period_ns,uint64_t trigger) {
+    FILE *outf = fopen(path,"wb");
+    s_rawcap_hdr hdr;
+    bool ok;
+
+    if ( !outf )
+        return errno;
+
+    memset(&hdr,0,sizeof hdr);
+    memcpy(hdr.magic,rawcap_magic,sizeof hdr.magic);
+    hdr.period_ns = period_ns;
+    hdr.n_samples = uint64_t(blocks.size()) * samps;
+    hdr.trigger = trigger;
+
+    ok = fwrite(&hdr,sizeof hdr,1,outf) == 1;
+    for ( size_t bx = 0; ok && bx < blocks.size(); ++bx )
+        ok = fwrite(blocks[bx],sizeof(uint32_t),samps,outf) == samps;
+
+    int er = ok ? 0 : errno ? errno : EIO;
+
+    if ( fclose(outf) != 0 && !er )
+        er = errno;
+    return er;
+}
+
+int
+RawCapture::load(const char *path) {
+    FILE *inf = fopen(path,"rb");
+    s_rawcap_hdr hdr;
+    bool ok;
+
+    if ( !inf )
+        return errno;
+
+    clear();
+
+    ok = fread(&hdr,sizeof hdr,1,inf) == 1
+      && !memcmp(hdr.magic,rawcap_magic,sizeof hdr.magic);
+
+    if ( ok ) {
+        long here = ftell(inf);
+
+        // Check the length before allocating for the samples
+        ok = here >= 0 && fseek(inf,0,SEEK_END) == 0
+          && uint64_t(ftell(inf) - here) / sizeof(uint32_t) == hdr.n_samples
+          && fseek(inf,here,SEEK_SET) == 0;
+    }
+
+    if ( ok ) {
+        samples.resize(hdr.n_samples);
+        ok = fread(samples.data(),sizeof(uint32_t),samples.size(),inf) == samples.size();
+    }
+
+    fclose(inf);
+
+    if ( !ok ) {
+        clear();
+        return EINVAL;
+    }
+
+    period_ns = hdr.period_ns;
+    trigger = hdr.trigger;
+    return 0;
+}
+
+// End rawcap.cpp
@@ -0,0 +1,450 @@
+//////////////////////////////////////////////////////////////////////
+// regio.cpp -- Peripheral Register Access Backends
+//
+// The GPIO and DMA classes map their registers from RegIO::backend():
+// /dev/mem (RegIOMem) unless RPI2_REGIO=sim is in the environment, or
+// the program has called RegIO::select(). The simulated backend lets
+// librpi2 and its tools run (and be profiled) on a host without a Pi.
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include <mutex>
+
+#include "regio.hpp"
+#include "mailbox.hpp"
+
+#define PERI_WINDOW     0x00FFFFFF      // Offset within peripheral window
+#define PERI_SIZE       0x01000000      // Bytes in the peripheral window
+#define BUS_BASE        0x7E000000      // Bus address of the window
+#define GPIO_OFFSET     0x00200000      // GPIO block in the window
+#define GPIO_SIZE       0x1000          // Bytes of /dev/gpiomem
+
+#define GPIO_GPFSEL0    0x7E200000
+#define GPIO_GPSET0     0x7E20001C
+#define GPIO_GPCLR0     0x7E200028
+#define GPIO_GPLEV0     0x7E200034
+#define GPIO_GPEDS0     0x7E200040
+#define GPIO_GPREN0     0x7E20004C
+#define GPIO_GPFEN0     0x7E200058
+#define GPIO_GPHEN0     0x7E200064
+#define GPIO_GPLEN0     0x7E200070
+#define GPIO_GPAREN0    0x7E20007C
+#define GPIO_GPAFEN0    0x7E200088
+#define GPIO_GPPUD      0x7E200094
+#define GPIO_GPUDCLK0   0x7E200098
+
+#define GPIO_PADS00_27  0x7E10002C      // 3 pad registers
+
+#define PWM_CTL         0x7E20C000
+#define PWM_STA         0x7E20C004
+#define PWM_STA_W1C     0x000001FC      // WERR1..BERR: write 1 to clear
+
+#define CM_PASSWD       0x5A000000
+
+static const uint32_t cm_ctls[] = {     // CM_xxCTL, each followed by CM_xxDIV
+    0x7E101070,         // CM_GP0CTL
+    0x7E101078,         // CM_GP1CTL
+    0x7E101080,         // CM_GP2CTL
+    0x7E101098,         // CM_PCMCTL
+    0x7E1010A0          // CM_PWMCTL
+};
+
+static RegIOMem regio_mem;
+static RegIO *regio = nullptr;          // Selected backend
+static std::mutex regio_lock;
+
+static uint8_t *peri_map = nullptr;     // Peripheral window (or GPIO block)
+static off_t peri_phys = 0;             // Physical address of window
+static bool peri_gpiomem = false;       // peri_map is /dev/gpiomem
+static int peri_refs = 0;               // Outstanding map() calls
+static std::mutex peri_lock;
+
+//////////////////////////////////////////////////////////////////////
+// Return the selected backend, choosing one at first use
+//////////////////////////////////////////////////////////////////////
+
+RegIO *
+RegIO::backend() {
+
+    regio_lock.lock();
+    if ( !regio ) {
+        const char *cp = getenv(REGIO_ENV);
+
+        if ( cp && !strcmp(cp,"sim") )
+            regio = new RegIOSim;       // Lives as long as the process
+        else
+            regio = &regio_mem;
+    }
+    RegIO *r = regio;
+    regio_lock.unlock();
+    return r;
+}
+
+RegIO *
+RegIO::select(RegIO *regio) {
+
+    regio_lock.lock();
+    RegIO *prev = ::regio;
+    ::regio = regio;                    // nullptr: choose again at next use
+    regio_lock.unlock();
+    return prev;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Map the GPIO block from /dev/gpiomem (no root needed)
+//////////////////////////////////////////////////////////////////////
+
+static void *
+map_gpiomem() {
+    int fd = ::open("/dev/gpiomem",O_RDWR|O_SYNC);
+
+    if ( fd < 0 )
+        return nullptr;
+
+    void *map = mmap(nullptr,GPIO_SIZE,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+    int er = errno;
+
+    ::close(fd);
+    errno = er;
+    return map == MAP_FAILED ? nullptr : map;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Return registers at physical offset, from the shared mapping
+//////////////////////////////////////////////////////////////////////
+
+void *
+RegIOMem::map(off_t offset,size_t bytes) {
+    const off_t phys = offset & ~off_t(PERI_WINDOW);
+    const uint32_t woff = uint32_t(offset) & PERI_WINDOW;
+    void *addr = nullptr;
+
+    peri_lock.lock();
+
+    if ( !peri_map ) {
+        peri_map = (uint8_t *)Mailbox::map(phys,PERI_SIZE);
+        peri_gpiomem = false;
+        if ( !peri_map ) {
+            int er = errno;
+
+            peri_map = (uint8_t *)map_gpiomem();
+            if ( peri_map )
+                peri_gpiomem = true;
+            else
+                errno = er;             // Report the /dev/mem error
+        }
+        if ( !peri_map ) {
+            peri_lock.unlock();
+            return nullptr;
+        }
+        peri_phys = phys;
+    }
+
+    if ( phys != peri_phys || woff + bytes > PERI_SIZE ) {
+        errno = EINVAL;                 // Not in the window
+    } else if ( peri_gpiomem ) {
+        if ( woff >= GPIO_OFFSET && woff + bytes <= GPIO_OFFSET + GPIO_SIZE )
+            addr = peri_map + ( woff - GPIO_OFFSET );
+        else
+            errno = EACCES;             // Only GPIO without root
+    } else  {
+        addr = peri_map + woff;
+    }
+
+    if ( addr )
+        ++peri_refs;
+    else if ( peri_refs <= 0 ) {
+        int er = errno;
+
+        munmap(peri_map,peri_gpiomem ? GPIO_SIZE : PERI_SIZE);
+        peri_map = nullptr;
+        errno = er;
+    }
+
+    peri_lock.unlock();
+    return addr;
+}
+
+int
+RegIOMem::unmap(void *addr,size_t bytes) {
+    int rc = 0;
+
+    peri_lock.lock();
+    if ( peri_map && --peri_refs <= 0 ) {
+        rc = munmap(peri_map,peri_gpiomem ? GPIO_SIZE : PERI_SIZE);
+        peri_map = nullptr;
+        peri_refs = 0;
+    }
+    peri_lock.unlock();
+    return rc;
+}
+
+bool
+RegIOMem::gpio_only() {
+    return peri_map && peri_gpiomem;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Simulated registers
+//////////////////////////////////////////////////////////////////////
+
+RegIOSim::RegIOSim() {
+    out[0] = out[1] = 0;
+    in[0] = in[1] = 0;
+    prev[0] = prev[1] = 0;
+    eds[0] = eds[1] = 0;
+    n_stores = 0;
+}
+
+RegIOSim::~RegIOSim() {
+
+    for ( auto& pair : blocks ) {
+        munmap(pair.second.image,pair.second.bytes);
+        delete[] pair.second.shadow;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+// Map (create) an image: Mapping the same offset again returns the
+// same image, so state survives GPIO instances coming and going.
+//////////////////////////////////////////////////////////////////////
+
+void *
+RegIOSim::map(off_t offset,size_t bytes) {
+    uint32_t woff = uint32_t(offset) & PERI_WINDOW;
+    auto it = blocks.find(woff);
+
+    if ( it != blocks.end() ) {
+        if ( it->second.bytes >= bytes )
+            return it->second.image;
+        errno = EINVAL;                 // Differently sized remap
+        return nullptr;
+    }
+
+    void *image = mmap(nullptr,bytes,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+
+    if ( image == MAP_FAILED )
+        return nullptr;
+
+    s_block& blk = blocks[woff];
+
+    blk.image = (uint32_t *)image;      // Zeroed
+    blk.bytes = bytes;
+    blk.shadow = new uint32_t[bytes / sizeof(uint32_t)]();
+
+    settle();                           // Reset values (PWM STA etc.)
+    return image;
+}
+
+int
+RegIOSim::unmap(void *addr,size_t bytes) {
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Image word for a bus address (nullptr if not mapped)
+//////////////////////////////////////////////////////////////////////
+
+uint32_t *
+RegIOSim::word(uint32_t bus_addr,uint32_t **shadow) {
+    uint32_t woff = bus_addr - BUS_BASE;
+
+    for ( auto& pair : blocks ) {
+        const s_block& blk = pair.second;
+
+        if ( woff >= pair.first && woff - pair.first < blk.bytes ) {
+            size_t wx = ( woff - pair.first ) / sizeof(uint32_t);
+
+            if ( shadow )
+                *shadow = blk.shadow + wx;
+            return blk.image + wx;
+        }
+    }
+    return nullptr;
+}
+
+uint32_v *
+RegIOSim::reg(uint32_t bus_addr) {
+    return word(bus_addr);
+}
+
+//////////////////////////////////////////////////////////////////////
+// GPIO: Levels, events and pulls
+//////////////////////////////////////////////////////////////////////
+
+void
+RegIOSim::settle_gpio(uint32_v *reg) {
+    uint32_t *g = word(GPIO_GPFSEL0);
+    uint32_t *r = (uint32_t *)reg;
+
+    if ( !g )
+        return;
+
+    #define G(a) g[((a)-GPIO_GPFSEL0)/sizeof(uint32_t)]
+
+    for ( unsigned b = 0; b < 2; ++b ) {
+        const uint32_t valid = b ? GPIO_BANK1_MASK : ~0u;
+        uint32_t omask = 0, lev;
+
+        for ( unsigned bit = 0; bit < 32 && b * 32 + bit <= GPIO_MAX; ++bit ) {
+            unsigned gpio = b * 32 + bit;
+            uint32_t fsel = G(GPIO_GPFSEL0 + gpio / 10 * 4) >> ( gpio % 10 * 3 );
+
+            if ( (fsel & 7) == GPIO::Output )
+                omask |= 1u << bit;
+        }
+
+        uint32_t& udclk = G(GPIO_GPUDCLK0 + b * 4);
+
+        if ( r == &udclk && udclk ) {
+            switch ( G(GPIO_GPPUD) & 3 ) {
+            case 0b10 :                 // Pullup
+                in[b] |= udclk;
+                break;
+            case 0b01 :                 // Pulldown
+                in[b] &= ~udclk;
+                break;
+            }
+        }
+
+        uint32_t& set = G(GPIO_GPSET0 + b * 4);
+        uint32_t& clr = G(GPIO_GPCLR0 + b * 4);
+        uint32_t& gpeds = G(GPIO_GPEDS0 + b * 4);
+
+        out[b] = ( out[b] | set ) & ~clr;
+        set = clr = 0;                  // Write only
+
+        if ( r == &gpeds )
+            eds[b] &= ~gpeds;           // Write 1 to clear
+
+        lev = ( ( out[b] & omask ) | ( in[b] & ~omask ) ) & valid;
+
+        uint32_t rise = lev & ~prev[b];
+        uint32_t fall = ~lev & prev[b];
+
+        eds[b] |= ( rise & ( G(GPIO_GPREN0 + b * 4) | G(GPIO_GPAREN0 + b * 4) ) )
+            | ( fall & ( G(GPIO_GPFEN0 + b * 4) | G(GPIO_GPAFEN0 + b * 4) ) )
+            | ( lev & G(GPIO_GPHEN0 + b * 4) )
+            | ( ~lev & G(GPIO_GPLEN0 + b * 4) );
+        eds[b] &= valid;
+
+        G(GPIO_GPLEV0 + b * 4) = prev[b] = lev;
+        gpeds = eds[b];
+    }
+
+    #undef G
+}
+
+//////////////////////////////////////////////////////////////////////
+// Registers that ignore writes lacking the 0x5A password
+//////////////////////////////////////////////////////////////////////
+
+void
+RegIOSim::settle_passwd(uint32_t bus_addr,unsigned n_words) {
+    uint32_t *shadow, *w = word(bus_addr,&shadow);
+
+    if ( !w )
+        return;
+
+    for ( unsigned x = 0; x < n_words; ++x ) {
+        if ( w[x] != shadow[x] && ( w[x] & 0xFF000000 ) == CM_PASSWD )
+            shadow[x] = w[x] & 0x00FFFFFF;
+        w[x] = shadow[x];
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+// Clock manager: BUSY follows ENAB, and KILL stops the generator
+//////////////////////////////////////////////////////////////////////
+
+void
+RegIOSim::settle_clocks() {
+
+    for ( uint32_t ctl : cm_ctls ) {
+        uint32_t *shadow, *w = word(ctl,&shadow);
+
+        if ( !w )
+            return;                     // Clock manager not mapped
+
+        settle_passwd(ctl,2);           // CTL and DIV
+
+        uint32_t v = w[0];
+
+        if ( v & 0x20 )                 // KILL
+            v &= ~0x30u;                // Clears ENAB
+        v = ( v & ~0x80u ) | ( ( v & 0x10 ) << 3 ); // BUSY = ENAB
+        w[0] = shadow[0] = v;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+// PWM: The FIFO drains at once, and STAx follows PWENx
+//////////////////////////////////////////////////////////////////////
+
+void
+RegIOSim::settle_pwm(uint32_v *reg) {
+    uint32_t *shadow, *w = word(PWM_CTL,&shadow);
+
+    if ( !w )
+        return;
+
+    uint32_t& ctl = w[0];
+    uint32_t& sta = w[1];
+    uint32_t v = shadow[1];
+
+    if ( (uint32_t *)reg == &sta )
+        v &= ~( sta & PWM_STA_W1C );
+    ctl &= ~0x40u;                      // CLRF1 reads as 0
+    v = ( v & ~0x603u ) | 0x2;          // EMPT1, not FULL1
+    v |= ( ctl & 0x001 ) << 9;          // STA1 = PWEN1
+    v |= ( ctl & 0x100 ) << 2;          // STA2 = PWEN2
+    sta = shadow[1] = v;
+}
+
+void
+RegIOSim::settle() {
+
+    settle_gpio(nullptr);
+    settle_passwd(GPIO_PADS00_27,3);
+    settle_clocks();
+    settle_pwm(nullptr);
+}
+
+void
+RegIOSim::stored(uint32_v *reg) {
+
+    ++n_stores;
+    settle_gpio(reg);
+    settle_passwd(GPIO_PADS00_27,3);
+    settle_clocks();
+    settle_pwm(reg);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Drive an input pin (as the outside world would)
+//////////////////////////////////////////////////////////////////////
+
+void
+RegIOSim::drive(int gpio,bool level) {
+
+    if ( gpio < 0 || gpio > GPIO_MAX )
+        return;
+
+    if ( level )
+        in[gpio / 32] |= 1u << ( gpio % 32 );
+    else
+        in[gpio / 32] &= ~( 1u << ( gpio % 32 ) );
+    settle();
+}
+
+// End regio.cpp
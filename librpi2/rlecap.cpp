@@ -0,0 +1,111 @@
+//////////////////////////////////////////////////////////////////////
+// rlecap.cpp -- Run-Length Encoded Capture Class Implementation
+//
+// Completed capture blocks are encoded as (value,count) runs, so that
+// memory use is proportional to signal activity rather than to the
+// number of samples. Build with -mfpu=neon to compare four samples
+// at a time while scanning long idle runs.
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#include <assert.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RLECAP_NEON 1
+#endif
+
+#include "rlecap.hpp"
+
+RLECapture::RLECapture() {
+    n_samples = 0;
+}
+
+void
+RLECapture::clear() {
+    runs.clear();
+    n_samples = 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Return the length of the run of value at the start of samples[n]
+//////////////////////////////////////////////////////////////////////
+
+static size_t
+run_length(const uint32_t *samples,size_t n,uint32_t value) {
+    size_t x = 0;
+
+#ifdef RLECAP_NEON
+    uint32x4_t vval = vdupq_n_u32(value);
+
+    for ( ; x + 4 <= n; x += 4 ) {
+        uint32x4_t veq = vceqq_u32(vld1q_u32(samples + x),vval);
+        uint32x2_t vmin = vpmin_u32(vget_low_u32(veq),vget_high_u32(veq));
+
+        vmin = vpmin_u32(vmin,vmin);
+        if ( vget_lane_u32(vmin,0) == 0 )
+            break;                  // A change within these 4
+    }
+#endif
+    while ( x < n && samples[x] == value )
+        ++x;
+    return x;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Encode n more samples, extending the last run where possible
+//////////////////////////////////////////////////////////////////////
+
+void
+RLECapture::append(const uint32_t *samples,size_t n) {
+    size_t x = 0;
+
+    while ( x < n ) {
+        uint32_t value = samples[x];
+        size_t len = run_length(samples + x,n - x,value);
+
+        n_samples += len;
+        x += len;
+
+        // Extend the last run, unless its count would overflow
+        while ( len > 0 ) {
+            if ( !runs.empty() && runs.back().value == value
+              && runs.back().count < 0xFFFFFFFFu ) {
+                uint32_t room = 0xFFFFFFFFu - runs.back().count;
+                uint32_t add = len < room ? uint32_t(len) : room;
+
+                runs.back().count += add;
+                len -= add;
+            } else  {
+                s_rle_run run;
+
+                run.value = value;
+                run.count = 0;
+                runs.push_back(run);
+            }
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+// Return sample # index (which must be < get_samples())
+//////////////////////////////////////////////////////////////////////
+
+uint32_t
+RLECapture::sample(uint64_t index) const {
+    uint64_t start = 0;
+
+    assert(index < n_samples);
+
+    for ( const s_rle_run& run : runs ) {
+        if ( index < start + run.count )
+            return run.value;
+        start += run.count;
+    }
+    return 0;
+}
+
+// End rlecap.cpp
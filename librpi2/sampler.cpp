@@ -0,0 +1,150 @@
+//////////////////////////////////////////////////////////////////////
+// sampler.cpp -- Real-time GPIO Level Sampler Implementation
+//
+// The thread raises itself to SCHED_FIFO, optionally pins itself to
+// one CPU, then reads GPLEV0/1 once per period. Only samples whose
+// levels differ from the last one pushed go into the ring, so a quiet
+// bus costs no ring space. Periods under SAMPLER_SPIN_NS are timed by
+// spinning on the clock (the CPU stays busy), longer ones by sleeping
+// to an absolute deadline.
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include "sampler.hpp"
+
+static inline uint64_t
+mono_ns() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return uint64_t(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+Sampler::Sampler(GPIO& gpio,size_t ring_slots) : gpio(gpio), ring(ring_slots) {
+    running = false;
+    started = false;
+    period_ns = 0;
+    cpu = -1;
+    priority = SAMPLER_PRIORITY;
+    sched_err = 0;
+    n_samples = n_changes = n_overruns = n_late = 0;
+}
+
+Sampler::~Sampler() {
+    stop();
+}
+
+//////////////////////////////////////////////////////////////////////
+// Start the thread: Failing to get SCHED_FIFO (not root) or the CPU
+// is not fatal; the thread samples anyway, and get_sched_error()
+// reports why it is not real-time.
+//////////////////////////////////////////////////////////////////////
+
+int
+Sampler::start(uint64_t period_ns,int cpu,int priority) {
+
+    if ( running || thread.joinable() )
+        return EBUSY;
+    else if ( period_ns < 1 || gpio.get_error() )
+        return gpio.get_error() ? gpio.get_error() : EINVAL;
+
+    this->period_ns = period_ns;
+    this->cpu = cpu;
+    this->priority = priority;
+    sched_err = 0;
+    n_samples = n_changes = n_overruns = n_late = 0;
+
+    running = true;
+    started = false;
+    thread = std::thread(&Sampler::run,this);
+
+    while ( !started )              // Wait for sched_err
+        std::this_thread::yield();
+    return 0;
+}
+
+void
+Sampler::stop() {
+
+    running = false;
+    if ( thread.joinable() )
+        thread.join();
+}
+
+//////////////////////////////////////////////////////////////////////
+// The sampling thread
+//////////////////////////////////////////////////////////////////////
+
+void
+Sampler::run() {
+    struct sched_param param;
+    uint64_t last = 0, next;
+    bool first = true;
+
+    param.sched_priority = priority;
+    sched_err = pthread_setschedparam(pthread_self(),SCHED_FIFO,&param);
+
+    if ( cpu >= 0 ) {
+        cpu_set_t cpus;
+        int rc;
+
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu,&cpus);
+        rc = pthread_setaffinity_np(pthread_self(),sizeof cpus,&cpus);
+        if ( rc && !sched_err )
+            sched_err = rc;
+    }
+    started = true;
+
+    next = mono_ns();
+
+    while ( running.load(std::memory_order_relaxed) ) {
+        uint64_t levels = gpio.read_mask();
+        s_sample sample;
+
+        sample.time_ns = mono_ns();
+        n_samples.fetch_add(1,std::memory_order_relaxed);
+
+        if ( first || levels != last ) {
+            sample.levels = levels;
+            if ( ring.push(sample) ) {
+                n_changes.fetch_add(1,std::memory_order_relaxed);
+                last = levels;
+                first = false;
+            } else  {
+                // Ring full: Push this change again next period
+                n_overruns.fetch_add(1,std::memory_order_relaxed);
+            }
+        }
+
+        next += period_ns;
+        if ( sample.time_ns > next + period_ns ) {
+            // Whole periods skipped by resynchronizing
+            n_late.fetch_add(( sample.time_ns - next ) / period_ns,std::memory_order_relaxed);
+            next = sample.time_ns;  // Resynchronize
+        }
+
+        if ( period_ns < SAMPLER_SPIN_NS ) {
+            while ( mono_ns() < next )
+                ;
+        } else  {
+            struct timespec ts;
+
+            ts.tv_sec = next / 1000000000ull;
+            ts.tv_nsec = next % 1000000000ull;
+            while ( clock_nanosleep(CLOCK_MONOTONIC,TIMER_ABSTIME,&ts,nullptr) == EINTR )
+                ;
+        }
+    }
+}
+
+// End sampler.cpp
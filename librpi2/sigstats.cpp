@@ -0,0 +1,186 @@
+//////////////////////////////////////////////////////////////////////
+// sigstats.cpp -- Per-Channel Signal Statistics Implementation
+//
+// One streaming pass over the sample blocks: Adjacent samples are
+// XORed, unchanged samples are skipped, and popcount of the changed
+// bits tallies the total edges. Only the changed bits are visited to
+// update each channel's pulse widths and time spent high.
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include <assert.h>
+
+#include "sigstats.hpp"
+
+SignalStats::SignalStats() {
+    clear();
+}
+
+void
+SignalStats::clear() {
+
+    memset(chans,0,sizeof chans);
+    for ( unsigned ch = 0; ch < SIGSTATS_CHANNELS; ++ch )
+        chans[ch].min_high = chans[ch].min_low = ~0u;
+    n_samples = total_edges = 0;
+    prev = 0;
+    done = false;
+}
+
+void
+SignalStats::feed(const uint32_t *samples,size_t n) {
+    size_t x = 0;
+
+    assert(!done);
+    if ( n < 1 )
+        return;
+
+    if ( n_samples == 0 ) {
+        prev = samples[0];          // Initial levels
+        x = 1;
+    }
+
+    for ( ; x < n; ++x ) {
+        uint32_t changed = samples[x] ^ prev;
+
+        if ( !changed )
+            continue;               // Usual case: Idle
+
+        uint64_t index = n_samples + x;
+
+        total_edges += __builtin_popcount(changed);
+        prev = samples[x];
+
+        do  {
+            unsigned ch = __builtin_ctz(changed);
+            s_chanstats& cs = chans[ch];
+            uint64_t width = index - cs.last_edge;
+            bool rise = (prev >> ch) & 1;
+
+            if ( rise ) {
+                // A low pulse has ended
+                if ( cs.edges > 0 ) {
+                    if ( width < cs.min_low )
+                        cs.min_low = uint32_t(width);
+                    if ( width > cs.max_low )
+                        cs.max_low = uint32_t(width);
+                }
+                if ( cs.rising++ == 0 )
+                    cs.first_rise = index;
+                cs.last_rise = index;
+            } else  {
+                // A high pulse has ended
+                cs.high += width;
+                if ( cs.edges > 0 ) {
+                    if ( width < cs.min_high )
+                        cs.min_high = uint32_t(width);
+                    if ( width > cs.max_high )
+                        cs.max_high = uint32_t(width);
+                }
+            }
+
+            ++cs.edges;
+            cs.last_edge = index;
+            changed &= changed - 1;
+        } while ( changed );
+    }
+
+    n_samples += n;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Add the trailing high time of channels that ended high
+//////////////////////////////////////////////////////////////////////
+
+void
+SignalStats::finish() {
+
+    if ( done )
+        return;
+
+    for ( unsigned ch = 0; ch < SIGSTATS_CHANNELS; ++ch ) {
+        if ( (prev >> ch) & 1 )
+            chans[ch].high += n_samples - chans[ch].last_edge;
+    }
+    done = true;
+}
+
+double
+SignalStats::frequency(unsigned ch,double period_ns) const {
+    const s_chanstats& cs = chans[ch];
+
+    if ( cs.rising < 2 || period_ns <= 0.0 )
+        return 0.0;
+    return ( cs.rising - 1 ) * 1e9 / ( ( cs.last_rise - cs.first_rise ) * period_ns );
+}
+
+double
+SignalStats::duty(unsigned ch) const {
+    return n_samples > 0 ? double(chans[ch].high) / n_samples : 0.0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Summary table: Only channels with edges, unless all is true
+//////////////////////////////////////////////////////////////////////
+
+void
+SignalStats::write_table(FILE *outf,double period_ns,bool all) const {
+    const double us = period_ns / 1000.0;
+
+    fprintf(outf,"%-6s %8s %12s %7s %10s %10s %10s %10s\n",
+        "GPIO","Edges","Freq Hz","Duty %",
+        "MinHi us","MaxHi us","MinLo us","MaxLo us");
+
+    for ( unsigned ch = 0; ch < SIGSTATS_CHANNELS; ++ch ) {
+        const s_chanstats& cs = chans[ch];
+
+        if ( !all && cs.edges == 0 )
+            continue;
+
+        fprintf(outf,"gpio%-2u %8u %12.1f %7.2f ",
+            ch,cs.edges,frequency(ch,period_ns),duty(ch) * 100.0);
+
+        if ( cs.max_high > 0 )
+            fprintf(outf,"%10.3f %10.3f ",cs.min_high * us,cs.max_high * us);
+        else
+            fprintf(outf,"%10s %10s ","-","-");
+
+        if ( cs.max_low > 0 )
+            fprintf(outf,"%10.3f %10.3f\n",cs.min_low * us,cs.max_low * us);
+        else
+            fprintf(outf,"%10s %10s\n","-","-");
+    }
+}
+
+void
+SignalStats::write_json(FILE *outf,double period_ns) const {
+    const double us = period_ns / 1000.0;
+
+    fprintf(outf,"{\"samples\":%llu,\"sample_period_ns\":%.3f,\"edges\":%llu,\"channels\":[",
+        (unsigned long long)n_samples,period_ns,(unsigned long long)total_edges);
+
+    for ( unsigned ch = 0; ch < SIGSTATS_CHANNELS; ++ch ) {
+        const s_chanstats& cs = chans[ch];
+
+        fprintf(outf,"%s\n {\"gpio\":%u,\"edges\":%u,\"rising\":%u,"
+            "\"frequency_hz\":%.3f,\"duty\":%.5f",
+            ch ? "," : "",ch,cs.edges,cs.rising,
+            frequency(ch,period_ns),duty(ch));
+
+        if ( cs.max_high > 0 )
+            fprintf(outf,",\"min_high_us\":%.3f,\"max_high_us\":%.3f",
+                cs.min_high * us,cs.max_high * us);
+        if ( cs.max_low > 0 )
+            fprintf(outf,",\"min_low_us\":%.3f,\"max_low_us\":%.3f",
+                cs.min_low * us,cs.max_low * us);
+        fputc('}',outf);
+    }
+
+    fputs("\n]}\n",outf);
+}
+
+// End sigstats.cpp
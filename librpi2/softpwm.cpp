@@ -0,0 +1,279 @@
+//////////////////////////////////////////////////////////////////////
+// softpwm.cpp -- DMA driven soft PWM Implementation
+//
+// The period is divided into n_slots slots of step_us. Each slot is a
+// pair of looping DMA CBs: One writes the slot's masks to GPSET0/1
+// (slot 0) or GPCLR0/1 (the others), and one stalls on the pacer's
+// DREQ for one step. A pin with width w slots is in slot 0's set mask
+// and in slot w's clear mask, so changing a width moves one bit
+// between two slot words while the DMA keeps running.
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <math.h>
+
+#include <sstream>
+
+#include "softpwm.hpp"
+
+#define SPWM_GPSET0     0x7E20001C  // Bus addresses
+#define SPWM_GPCLR0     0x7E200028
+
+SoftPWM::SoftPWM() {
+    dma = nullptr;
+    pacer = nullptr;
+    cbs = nullptr;
+    slots = nullptr;
+    cb_bus = 0;
+    n_slots = 0;
+    step_us = 0.0;
+    memset(clear_at,0,sizeof clear_at);
+    memset(high,0,sizeof high);
+    channel = SPWM_CHAN;
+}
+
+SoftPWM::~SoftPWM() {
+    close();
+}
+
+//////////////////////////////////////////////////////////////////////
+// Build the slot chain and start it, with every pin idle
+//////////////////////////////////////////////////////////////////////
+
+bool
+SoftPWM::open(unsigned period_us,unsigned step_us) {
+    std::stringstream ss;
+    int rc;
+
+    close();
+
+    if ( gpio.get_error() ) {
+        ss << strerror(gpio.get_error()) << ": Opening GPIO";
+        errmsg = ss.str();
+        return false;
+    }
+
+    if ( step_us < 1 || period_us < step_us * 2 ) {
+        errmsg = "Soft PWM needs a step of 1 us or more, and 2 or more steps per period";
+        return false;
+    }
+
+    pacer = new Pacer;
+    if ( (rc = pacer->start(1e6 / step_us)) != 0 ) {
+        ss << strerror(rc) << ": Starting PWM pacer for " << step_us << " us steps";
+        errmsg = ss.str();
+        close();
+        return false;
+    }
+    this->step_us = 1e6 / pacer->get_rate();    // Step actually achieved
+    n_slots = unsigned(floor(period_us / this->step_us + 0.5));
+
+    dma = new DMA;
+    if ( dma->get_error() || !dma->set_channel(channel) ) {
+        ss << strerror(dma->get_error() ? dma->get_error() : EINVAL)
+           << ": Opening DMA channel " << channel;
+        errmsg = ss.str();
+        close();
+        return false;
+    }
+
+    if ( !dma->create(1) ) {
+        ss << strerror(errno) << ": Opening the mailbox";
+        errmsg = ss.str();
+        close();
+        return false;
+    }
+
+    const uint32_t page_size = dma->get_page_size();
+    size_t bytes = n_slots * ( 2 * sizeof(DMA::CB) + sizeof(s_slot) ) + sizeof(uint32_t);
+    size_t pages = ( bytes + page_size - 1 ) / page_size;
+    void *mem = dma->allocate(pages);
+
+    if ( !mem ) {
+        ss << strerror(errno) << ": Allocating " << pages << " pages of DMA memory";
+        errmsg = ss.str();
+        close();
+        return false;
+    }
+
+    cbs = (DMA::CB *)mem;
+    slots = (s_slot *)(cbs + 2 * n_slots);
+    cb_bus = dma->bus_handle(mem);
+
+    const uint32_t slots_bus = cb_bus + 2 * n_slots * sizeof(DMA::CB);
+    const uint32_t dummy_bus = slots_bus + n_slots * sizeof(s_slot);
+
+    memset(slots,0,n_slots * sizeof(s_slot) + sizeof(uint32_t));
+
+    for ( unsigned x = 0; x < n_slots; ++x ) {
+        DMA::CB& wr = cbs[2*x];
+        DMA::CB& pace = cbs[2*x+1];
+
+        wr.clear();
+        wr.TI.NO_WIDE_BURSTS = 1;
+        wr.TI.WAIT_RESP = 1;
+        wr.TI.SRC_INC = 1;
+        wr.TI.DEST_INC = 1;
+        wr.SOURCE_AD = slots_bus + x * sizeof(s_slot);
+        wr.DEST_AD = x == 0 ? SPWM_GPSET0 : SPWM_GPCLR0;
+        wr.TXFR_LEN = sizeof(s_slot);   // Both banks
+        wr.NEXTCONBK = cb_bus + ( 2 * x + 1 ) * sizeof(DMA::CB);
+
+        pace.clear();
+        pace.TI.NO_WIDE_BURSTS = 1;
+        pace.TI.WAIT_RESP = 1;
+        pace.TI.DEST_DREQ = 1;
+        pace.TI.PERMAP = Pacer::dreq();
+        pace.SOURCE_AD = dummy_bus;
+        pace.DEST_AD = Pacer::fifo_addr();
+        pace.TXFR_LEN = sizeof(uint32_t);
+        pace.NEXTCONBK = cb_bus + ( x + 1 < n_slots ? 2 * ( x + 1 ) : 0 ) * sizeof(DMA::CB);
+    }
+    __sync_synchronize();
+
+    if ( !dma->start(cb_bus) ) {
+        errmsg = "Unable to start the soft PWM DMA channel";
+        close();
+        return false;
+    }
+    return true;
+}
+
+void
+SoftPWM::close() {
+    uint64_t driven = 0;
+
+    if ( dma ) {
+        dma->abort();
+        delete dma;                     // Releases the chain
+        dma = nullptr;
+    }
+
+    if ( pacer ) {
+        delete pacer;                   // Stops the pacer
+        pacer = nullptr;
+    }
+
+    for ( int g = 0; g <= GPIO_MAX; ++g )
+        if ( high[g] )
+            driven |= uint64_t(1) << g;
+    if ( driven && !gpio.get_error() )
+        gpio.write_mask(0,driven);      // Leave the pins low
+
+    cbs = nullptr;
+    slots = nullptr;
+    cb_bus = 0;
+    n_slots = 0;
+    step_us = 0.0;
+    memset(clear_at,0,sizeof clear_at);
+    memset(high,0,sizeof high);
+}
+
+int
+SoftPWM::current_slot() {
+
+    if ( !dma )
+        return -1;
+
+    uint32_t cb_addr = dma->conblk_ad();
+
+    if ( cb_addr < cb_bus || cb_addr >= cb_bus + 2 * n_slots * sizeof(DMA::CB) )
+        return -1;
+    return ( cb_addr - cb_bus ) / ( 2 * sizeof(DMA::CB) );
+}
+
+//////////////////////////////////////////////////////////////////////
+// Move gpio's clear to slot (0 = none). The new clear is added
+// before the old one is removed (both present is harmless). When the
+// clear moves earlier, the old one stays until the DMA is outside
+// [slot,old]: Otherwise a DMA already past slot would miss both
+// clears, and the pin would stay high for a whole period. Once
+// outside, the DMA meets a clear before the next set, even if this
+// thread is preempted before the removal.
+//////////////////////////////////////////////////////////////////////
+
+void
+SoftPWM::move_clear(int gpio,unsigned slot) {
+    const unsigned bank = gpio / 32;
+    const uint32_t mask = 1u << ( gpio % 32 );
+    const unsigned old = clear_at[gpio];
+
+    if ( slot == old )
+        return;
+
+    if ( slot )
+        slots[slot].mask[bank] |= mask;
+    __sync_synchronize();
+
+    if ( slot != 0 && old != 0 && slot < old ) {
+        const useconds_t nap = useconds_t(step_us) > 0 ? useconds_t(step_us) : 1;
+        int at;
+
+        while ( (at = current_slot()) >= 0 && unsigned(at) >= slot && unsigned(at) <= old )
+            usleep(nap);
+    }
+
+    if ( old )
+        slots[old].mask[bank] &= ~mask;
+    clear_at[gpio] = slot;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Set the high time of gpio's pulse, in microseconds
+//////////////////////////////////////////////////////////////////////
+
+bool
+SoftPWM::set_width(int gpio,double us) {
+    std::stringstream ss;
+
+    if ( !slots ) {
+        errmsg = "Soft PWM is not open";
+        return false;
+    }
+
+    if ( gpio < 0 || gpio > GPIO_MAX ) {
+        ss << "Invalid GPIO " << gpio;
+        errmsg = ss.str();
+        return false;
+    }
+
+    const unsigned bank = gpio / 32;
+    const uint32_t mask = 1u << ( gpio % 32 );
+    double w = floor(us / step_us + 0.5);
+    unsigned width = w <= 0.0 ? 0 : w >= n_slots ? n_slots : unsigned(w);
+
+    if ( width == 0 ) {
+        slots[0].mask[bank] &= ~mask;   // No more rising edges
+        high[gpio] = false;
+        move_clear(gpio,1);             // End a pulse in progress
+    } else  {
+        move_clear(gpio,width < n_slots ? width : 0);
+        if ( !high[gpio] ) {
+            __sync_synchronize();
+            slots[0].mask[bank] |= mask;
+            high[gpio] = true;
+        }
+    }
+    return true;
+}
+
+bool
+SoftPWM::set_duty(int gpio,double fraction) {
+    return set_width(gpio,fraction * get_period());
+}
+
+double
+SoftPWM::get_width(int gpio) {
+
+    if ( gpio < 0 || gpio > GPIO_MAX || !high[gpio] )
+        return 0.0;
+    return ( clear_at[gpio] ? clear_at[gpio] : n_slots ) * step_us;
+}
+
+// End softpwm.cpp
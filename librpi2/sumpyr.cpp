@@ -0,0 +1,317 @@
+//////////////////////////////////////////////////////////////////////
+// sumpyr.cpp -- Multi-Resolution Summary Pyramid Implementation
+//
+// Level 0 buckets summarize base samples each: The OR and AND of the
+// levels seen, and the transitions per channel (an edge belongs to
+// the bucket holding the sample with the new level). Each coarser
+// level combines SUMPYR_FANOUT buckets of the level below, until one
+// bucket covers the capture. A viewer draws any zoom from the level
+// whose buckets are no wider than a column, so the work is bounded by
+// the display width rather than the capture length.
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <assert.h>
+
+#include "sumpyr.hpp"
+
+//////////////////////////////////////////////////////////////////////
+// Sidecar file header: Followed for each level by its bucket width,
+// bucket count, then the ors[], ands[] and edges[] arrays (host byte
+// order).
+//////////////////////////////////////////////////////////////////////
+
+static const char sumpyr_magic[8] = { 'R','P','I','2','S','U','M','1' };
+
+struct s_sumpyr_hdr {
+    char        magic[8];
+    uint32_t    fanout;             // SUMPYR_FANOUT
+    uint32_t    base;               // Samples per level 0 bucket
+    uint32_t    levels;             // Levels that follow
+    uint32_t    initial;            // Levels of sample 0
+    uint64_t    n_samples;          // Samples summarized
+};
+
+SummaryPyramid::SummaryPyramid(unsigned base) {
+    this->base = base >= 1 ? base : 1;
+    clear();
+}
+
+void
+SummaryPyramid::clear() {
+
+    levels.clear();
+    n_samples = 0;
+    initial = prev = 0;
+    memset(&cur,0,sizeof cur);
+    cur.and_bits = ~0u;
+    cur_n = 0;
+    done = false;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Append the level 0 bucket being filled
+//////////////////////////////////////////////////////////////////////
+
+void
+SummaryPyramid::flush() {
+
+    if ( levels.empty() ) {
+        levels.resize(1);
+        levels[0].bucket = base;
+    }
+
+    s_level& lev = levels[0];
+
+    lev.ors.push_back(cur.or_bits);
+    lev.ands.push_back(cur.and_bits);
+    lev.edges.insert(lev.edges.end(),cur.edges,cur.edges+SUMPYR_CHANNELS);
+
+    memset(&cur,0,sizeof cur);
+    cur.and_bits = ~0u;
+    cur_n = 0;
+}
+
+void
+SummaryPyramid::feed(const uint32_t *samples,size_t n) {
+
+    assert(!done);
+    if ( n < 1 )
+        return;
+
+    if ( n_samples == 0 )
+        initial = prev = samples[0];
+
+    for ( size_t x = 0; x < n; ++x ) {
+        uint32_t sample = samples[x];
+        uint32_t changed = sample ^ prev;
+
+        cur.or_bits |= sample;
+        cur.and_bits &= sample;
+
+        while ( changed ) {
+            ++cur.edges[__builtin_ctz(changed)];
+            changed &= changed - 1;
+        }
+        prev = sample;
+
+        if ( ++cur_n >= base )
+            flush();
+    }
+
+    n_samples += n;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Close the last partial bucket and build the coarser levels
+//////////////////////////////////////////////////////////////////////
+
+void
+SummaryPyramid::finish() {
+
+    if ( done )
+        return;
+
+    if ( cur_n > 0 )
+        flush();
+
+    while ( !levels.empty() && levels.back().ors.size() > 1 ) {
+        levels.resize(levels.size()+1);
+
+        const s_level& fine = levels[levels.size()-2];
+        s_level& coarse = levels.back();
+        size_t n = fine.ors.size();
+
+        coarse.bucket = fine.bucket * SUMPYR_FANOUT;
+
+        for ( size_t bx = 0; bx < n; bx += SUMPYR_FANOUT ) {
+            s_summary sum;
+
+            memset(&sum,0,sizeof sum);
+            sum.and_bits = ~0u;
+            for ( size_t cx = bx; cx < n && cx < bx + SUMPYR_FANOUT; ++cx )
+                accumulate(sum,fine,cx);
+
+            coarse.ors.push_back(sum.or_bits);
+            coarse.ands.push_back(sum.and_bits);
+            coarse.edges.insert(coarse.edges.end(),sum.edges,sum.edges+SUMPYR_CHANNELS);
+        }
+    }
+
+    done = true;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Merge bucket bx of lev into sum
+//////////////////////////////////////////////////////////////////////
+
+void
+SummaryPyramid::accumulate(s_summary& sum,const s_level& lev,size_t bx) const {
+    const uint32_t *edges = &lev.edges[bx * SUMPYR_CHANNELS];
+
+    sum.or_bits |= lev.ors[bx];
+    sum.and_bits &= lev.ands[bx];
+    for ( unsigned ch = 0; ch < SUMPYR_CHANNELS; ++ch )
+        sum.edges[ch] += edges[ch];
+}
+
+void
+SummaryPyramid::bucket(unsigned level,size_t bx,s_summary& sum) const {
+
+    memset(&sum,0,sizeof sum);
+    sum.and_bits = ~0u;
+    accumulate(sum,levels[level],bx);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Zoom rendering: A channel is steady across a column when its OR
+// and AND bits agree, otherwise edges[] gives the activity.
+//////////////////////////////////////////////////////////////////////
+
+void
+SummaryPyramid::render(uint64_t from,uint64_t to,unsigned columns,std::vector<s_summary>& out) const {
+
+    out.clear();
+    if ( levels.empty() || columns < 1 )
+        return;
+
+    if ( to > n_samples )
+        to = n_samples;
+    if ( from >= to )
+        return;
+
+    const uint64_t span = to - from;
+    const uint64_t width = span / columns > 0 ? span / columns : 1;
+    unsigned level = 0;
+
+    while ( level + 1 < levels.size() && levels[level+1].bucket <= width )
+        ++level;
+
+    const s_level& lev = levels[level];
+    const size_t n = lev.ors.size();
+
+    out.resize(columns);
+    for ( unsigned col = 0; col < columns; ++col ) {
+        s_summary& sum = out[col];
+        uint64_t c0 = from + span * col / columns;
+        uint64_t c1 = from + span * (col + 1) / columns;
+        size_t b0 = c0 / lev.bucket;
+        size_t b1 = ( c1 + lev.bucket - 1 ) / lev.bucket;
+
+        memset(&sum,0,sizeof sum);
+        sum.and_bits = ~0u;
+        if ( b1 <= b0 )
+            b1 = b0 + 1;
+        for ( size_t bx = b0; bx < b1 && bx < n; ++bx )
+            accumulate(sum,lev,bx);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+// Write the pyramid to a sidecar file
+//////////////////////////////////////////////////////////////////////
+
+int
+SummaryPyramid::save(const char *path) const {
+    FILE *outf = fopen(path,"wb");
+    s_sumpyr_hdr hdr;
+    bool ok;
+
+    if ( !outf )
+        return errno;
+
+    memset(&hdr,0,sizeof hdr);
+    memcpy(hdr.magic,sumpyr_magic,sizeof hdr.magic);
+    hdr.fanout = SUMPYR_FANOUT;
+    hdr.base = base;
+    hdr.levels = levels.size();
+    hdr.initial = initial;
+    hdr.n_samples = n_samples;
+
+    ok = fwrite(&hdr,sizeof hdr,1,outf) == 1;
+
+    for ( size_t lx = 0; ok && lx < levels.size(); ++lx ) {
+        const s_level& lev = levels[lx];
+        uint64_t counts[2] = { lev.bucket, lev.ors.size() };
+        size_t n = lev.ors.size();
+
+        ok = fwrite(counts,sizeof counts,1,outf) == 1
+          && fwrite(lev.ors.data(),sizeof(uint32_t),n,outf) == n
+          && fwrite(lev.ands.data(),sizeof(uint32_t),n,outf) == n
+          && fwrite(lev.edges.data(),sizeof(uint32_t),n*SUMPYR_CHANNELS,outf) == n*SUMPYR_CHANNELS;
+    }
+
+    int er = ok ? 0 : errno ? errno : EIO;
+
+    if ( fclose(outf) != 0 && !er )
+        er = errno;
+    return er;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Read a sidecar file written by save()
+//////////////////////////////////////////////////////////////////////
+
+int
+SummaryPyramid::load(const char *path) {
+    FILE *inf = fopen(path,"rb");
+    s_sumpyr_hdr hdr;
+    bool ok;
+
+    if ( !inf )
+        return errno;
+
+    clear();
+
+    ok = fread(&hdr,sizeof hdr,1,inf) == 1
+      && !memcmp(hdr.magic,sumpyr_magic,sizeof hdr.magic)
+      && hdr.fanout == SUMPYR_FANOUT
+      && hdr.base >= 1
+      && hdr.levels <= 64;
+
+    if ( ok ) {
+        base = hdr.base;
+        initial = prev = hdr.initial;
+        n_samples = hdr.n_samples;
+        levels.resize(hdr.levels);
+    }
+
+    for ( size_t lx = 0; ok && lx < levels.size(); ++lx ) {
+        s_level& lev = levels[lx];
+        uint64_t counts[2];
+
+        ok = fread(counts,sizeof counts,1,inf) == 1
+          && counts[1] <= n_samples;
+        if ( !ok )
+            break;
+
+        size_t n = counts[1];
+
+        lev.bucket = counts[0];
+        lev.ors.resize(n);
+        lev.ands.resize(n);
+        lev.edges.resize(n*SUMPYR_CHANNELS);
+
+        ok = fread(lev.ors.data(),sizeof(uint32_t),n,inf) == n
+          && fread(lev.ands.data(),sizeof(uint32_t),n,inf) == n
+          && fread(lev.edges.data(),sizeof(uint32_t),n*SUMPYR_CHANNELS,inf) == n*SUMPYR_CHANNELS;
+    }
+
+    fclose(inf);
+
+    if ( !ok ) {
+        clear();
+        return EINVAL;
+    }
+
+    done = true;
+    return 0;
+}
+
+// End sumpyr.cpp
@@ -81,6 +81,18 @@ VCD_Out::define_binary(int ref,const char *name) {
     wires[ref] = defn;
 }
 
+//////////////////////////////////////////////////////////////////////
+// Write a $comment (capture metadata). Comments written before the
+// first set_time()/set_value() appear in the VCD header.
+//////////////////////////////////////////////////////////////////////
+
+void
+VCD_Out::comment(const char *text) {
+
+    assert(vcdf);
+    fprintf(vcdf,"$comment %s $end\n",text);
+}
+
 void
 VCD_Out::write_defns() {
 
@@ -0,0 +1,318 @@
+//////////////////////////////////////////////////////////////////////
+// waveform.cpp -- DMA Waveform Engine Implementation
+//
+// A waveform is compiled into a looping chain of DMA control blocks:
+// A pacing CB writes n dummy words to the pacer FIFO with DEST_DREQ,
+// so it takes n ticks; GPCLR0 and GPSET0 CBs in between change the
+// pins. Step times therefore come from the pacer clock alone, with no
+// CPU involvement or scheduler jitter once started.
+//
+// Two chains are kept. load() compiles into the idle chain, then
+// points the last CB of the running chain at it, so the DMA changes
+// over at the end of a period (never mid waveform).
+//
+// The pins must be configured as outputs beforehand (GPIO::configure).
+//
+// Exploring the Raspberry Pi 2 with C++ (ISBN 978-1-4842-1738-2)
+// by Warren Gay VE3WWG
+// LGPL2 V2.1
+///////////////////////////////////////////////////////////////////////
+
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <sstream>
+
+#include "waveform.hpp"
+
+#define WAVE_GPSET0     0x7E20001C  // Bus addresses
+#define WAVE_GPCLR0     0x7E200028
+
+Waveform::Waveform(unsigned max_steps) {
+    dma = nullptr;
+    pacer = nullptr;
+    memset(chains,0,sizeof chains);
+    active = 0;
+    running = pending = false;
+    this->max_steps = max_steps >= 1 ? max_steps : 1;
+    max_cbs = 0;
+    channel = WAVE_CHAN;
+    pace_dreq = Pacer::dreq();
+    pace_addr = Pacer::fifo_addr();
+    rate = 0.0;
+}
+
+Waveform::~Waveform() {
+    close();
+}
+
+//////////////////////////////////////////////////////////////////////
+// Open the DMA channel, allocate both chains, and start the pacer
+//////////////////////////////////////////////////////////////////////
+
+bool
+Waveform::open(double tick_hz) {
+    std::stringstream ss;
+    int rc;
+
+    close();
+
+    dma = new DMA;
+    if ( dma->get_error() || !dma->set_channel(channel) ) {
+        ss << strerror(dma->get_error() ? dma->get_error() : EINVAL)
+           << ": Opening DMA channel " << channel;
+        errmsg = ss.str();
+        close();
+        return false;
+    }
+
+    if ( !dma->create(1) ) {
+        ss << strerror(errno) << ": Opening the mailbox";
+        errmsg = ss.str();
+        close();
+        return false;
+    }
+
+    // A pacing, clear and set CB per step, plus pacing CBs for long gaps
+    const uint32_t page_size = dma->get_page_size();
+    max_cbs = max_steps * 3 + 16;
+
+    size_t bytes = max_cbs * sizeof(DMA::CB) + ( max_steps * 2 + 1 ) * sizeof(uint32_t);
+    size_t pages = ( bytes + page_size - 1 ) / page_size;
+
+    for ( s_chain& chain : chains ) {
+        void *mem = dma->allocate(pages);
+
+        if ( !mem ) {
+            ss << strerror(errno) << ": Allocating " << pages << " pages of DMA memory";
+            errmsg = ss.str();
+            close();
+            return false;
+        }
+
+        chain.cbs = (DMA::CB *)mem;
+        chain.cb_bus = dma->bus_handle(mem);
+        chain.data = (uint32_t *)(chain.cbs + max_cbs);
+        chain.data_bus = chain.cb_bus + max_cbs * sizeof(DMA::CB);
+        chain.data[max_steps * 2] = 0;  // Dummy pacing word
+        chain.n_cbs = 0;
+    }
+
+    if ( pace_dreq == Pacer::dreq() && pace_addr == Pacer::fifo_addr() ) {
+        pacer = new Pacer;
+        if ( (rc = pacer->start(tick_hz)) != 0 ) {
+            ss << strerror(rc) << ": Starting PWM pacer at " << tick_hz << " Hz";
+            errmsg = ss.str();
+            close();
+            return false;
+        }
+        rate = pacer->get_rate();       // Rate actually achieved
+    } else  {
+        rate = tick_hz;                 // Caller runs the pacing FIFO
+    }
+
+    active = 0;
+    return true;
+}
+
+void
+Waveform::close() {
+
+    stop();
+
+    if ( pacer ) {
+        delete pacer;                   // Stops the pacer
+        pacer = nullptr;
+    }
+
+    if ( dma ) {
+        delete dma;                     // Releases the chains
+        dma = nullptr;
+    }
+
+    memset(chains,0,sizeof chains);
+    rate = 0.0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Compile steps into a chain that loops to itself
+//////////////////////////////////////////////////////////////////////
+
+bool
+Waveform::compile(s_chain& chain,const std::vector<s_step>& steps,uint32_t period) {
+    std::vector<s_step> sorted(steps);
+    std::stringstream ss;
+    const uint32_t dummy_bus = chain.data_bus + max_steps * 2 * sizeof(uint32_t);
+    unsigned cbx = 0, dx = 0;
+    uint32_t at = 0;
+
+    if ( period < 1 || steps.size() > max_steps ) {
+        ss << "Waveform needs 1 to " << max_steps << " steps and a period";
+        errmsg = ss.str();
+        return false;
+    }
+
+    std::stable_sort(sorted.begin(),sorted.end(),
+        [](const s_step& a,const s_step& b) { return a.tick < b.tick; });
+
+    if ( !sorted.empty() && sorted.back().tick >= period ) {
+        errmsg = "Waveform step at or after the end of the period";
+        return false;
+    }
+
+    // Wait ticks by pacing CBs
+    auto pace = [&](uint32_t ticks) -> bool {
+        while ( ticks > 0 ) {
+            uint32_t n = std::min(ticks,uint32_t(WAVE_PACE_TICKS));
+
+            if ( cbx >= max_cbs )
+                return false;
+
+            DMA::CB& cb = chain.cbs[cbx++];
+
+            cb.clear();
+            cb.TI.NO_WIDE_BURSTS = 1;
+            cb.TI.WAIT_RESP = 1;
+            cb.TI.DEST_DREQ = 1;
+            cb.TI.PERMAP = pace_dreq;
+            cb.SOURCE_AD = dummy_bus;
+            cb.DEST_AD = pace_addr;
+            cb.TXFR_LEN = n * sizeof(uint32_t);
+            ticks -= n;
+        }
+        return true;
+    };
+
+    // Write mask to a GPIO register
+    auto store = [&](uint32_t mask,uint32_t reg) -> bool {
+        if ( cbx >= max_cbs )
+            return false;
+
+        DMA::CB& cb = chain.cbs[cbx++];
+
+        chain.data[dx] = mask;
+        cb.clear();
+        cb.TI.NO_WIDE_BURSTS = 1;
+        cb.TI.WAIT_RESP = 1;
+        cb.SOURCE_AD = chain.data_bus + dx++ * sizeof(uint32_t);
+        cb.DEST_AD = reg;
+        cb.TXFR_LEN = sizeof(uint32_t);
+        return true;
+    };
+
+    bool ok = true;
+
+    for ( size_t x = 0; ok && x < sorted.size(); ) {
+        uint32_t tick = sorted[x].tick, set = 0, clear = 0;
+
+        // Steps at the same tick combine, in order
+        for ( ; x < sorted.size() && sorted[x].tick == tick; ++x ) {
+            set = ( set & ~sorted[x].clear ) | sorted[x].set;
+            clear = ( clear | sorted[x].clear ) & ~sorted[x].set;
+        }
+
+        ok = pace(tick - at)
+          && ( !clear || store(clear,WAVE_GPCLR0) )
+          && ( !set || store(set,WAVE_GPSET0) );
+        at = tick;
+    }
+
+    if ( !ok || !pace(period - at) ) {
+        ss << "Waveform needs more than " << max_cbs << " control blocks";
+        errmsg = ss.str();
+        return false;
+    }
+
+    for ( unsigned x = 0; x < cbx; ++x )
+        chain.cbs[x].NEXTCONBK = chain.cb_bus + ( x + 1 < cbx ? x + 1 : 0 ) * sizeof(DMA::CB);
+    chain.n_cbs = cbx;
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Start a waveform, or queue it to replace the running one
+//////////////////////////////////////////////////////////////////////
+
+bool
+Waveform::load(const std::vector<s_step>& steps,uint32_t period) {
+
+    if ( !dma || !chains[0].cbs ) {
+        errmsg = "Waveform is not open";
+        return false;
+    }
+
+    if ( pending && !swapped() ) {
+        errmsg = "The previous waveform has not taken over yet";
+        return false;
+    }
+
+    s_chain& next = chains[running ? active ^ 1 : active];
+
+    if ( !compile(next,steps,period) )
+        return false;
+    __sync_synchronize();
+
+    if ( !running ) {
+        if ( !dma->start(next.cb_bus) ) {
+            errmsg = "Unable to start the waveform DMA channel";
+            return false;
+        }
+        running = true;
+        return true;
+    }
+
+    s_chain& cur = chains[active];
+
+    cur.cbs[cur.n_cbs-1].NEXTCONBK = next.cb_bus; // Leave at the period end
+    __sync_synchronize();
+    pending = true;
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+// The swap is complete once the DMA is executing the new chain
+//////////////////////////////////////////////////////////////////////
+
+bool
+Waveform::swapped() {
+
+    if ( !pending )
+        return true;
+
+    const s_chain& next = chains[active ^ 1];
+    uint32_t cb_addr = dma->conblk_ad();
+
+    if ( cb_addr >= next.cb_bus && cb_addr < next.cb_bus + next.n_cbs * sizeof(DMA::CB) ) {
+        active ^= 1;
+        pending = false;
+        return true;
+    }
+    return false;
+}
+
+bool
+Waveform::wait_swap(unsigned timeout_ms) {
+    struct timespec t0, t;
+
+    clock_gettime(CLOCK_MONOTONIC,&t0);
+    while ( !swapped() ) {
+        clock_gettime(CLOCK_MONOTONIC,&t);
+        if ( ( t.tv_sec - t0.tv_sec ) * 1000 + ( t.tv_nsec - t0.tv_nsec ) / 1000000 >= long(timeout_ms) )
+            return false;
+        usleep(100);
+    }
+    return true;
+}
+
+void
+Waveform::stop() {
+
+    if ( dma && running )
+        dma->abort();
+    running = pending = false;
+}
+
+// End waveform.cpp
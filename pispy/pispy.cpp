@@ -19,11 +19,14 @@
 #include <sys/poll.h>
 #include <assert.h>
 
+#include <algorithm>
+
 #include "dmamem.hpp"
 #include "gpio.hpp"
 #include "piutils.hpp"
 #include "logana.hpp"
 #include "vcdout.hpp"
+#include "protodec.hpp"
 
 #define PAGES   4
 
@@ -33,6 +36,23 @@
 #define TRIG_L  8   // Low
 
 static int opt_blocks = 8;
+static double opt_rate = 0.0;   // Paced sample rate (Hz), 0=free running
+static bool opt_stamps = false; // Timestamp samples with ST_CLO
+static const char *opt_uart = 0;  // -U rx[:baud]
+static const char *opt_spi = 0;   // -S cs:sck:mosi:miso[:mode]
+static const char *opt_i2c = 0;   // -I scl:sda
+static bool opt_csv = false;      // Decoded frames as CSV
+static bool opt_stats = false;    // -s Statistics table
+static bool opt_json = false;     // -j Statistics as JSON
+static int opt_N = 1;             // -N Segments
+static bool opt_P = false;        // -P Write summary sidecar
+static bool opt_W = false;        // -W Write raw capture
+
+struct s_segment {
+    unsigned        trigger;        // Trigger sample within segment
+    struct timespec when;           // When the trigger was seen
+    int             tries;          // Arms to get the trigger
+};
 static bool opt_verbose = false;
 static GPIO gpio;
 
@@ -44,9 +64,23 @@ usage(const char *cmd) {
         cmd = cp + 1;
 
     fprintf(stderr,
-        "Usage: %s [-b blocks] [-R gpio] [-F gpio] [-H gpio] [-L gpio] [-T n] [-x] [-z]\n"
+        "Usage: %s [-b blocks] [-r rate] [-t] [-U rx[:baud]] [-S cs:sck:mosi:miso[:mode]]\n"
+        "\t[-I scl:sda] [-C] [-s] [-j] [-N segs] [-P] [-W] [-R gpio] [-F gpio] [-H gpio] [-L gpio] [-T n] [-x] [-z]\n"
         "where:\n"
         "\t-b blocks\tHow many %uk blocks to sample (8)\n"
+        "\t-r rate\t\tSample at a fixed rate in Hz (DMA paced)\n"
+        "\t-t\t\tTimestamp each sample with the system timer\n"
+        "\t-U rx[:baud]\tDecode UART 8N1 on gpio rx (auto-baud)\n"
+        "\t-S cs:sck:mosi:miso[:mode]\n"
+        "\t\t\tDecode SPI mode 0-3 (0), -1 for an unused line\n"
+        "\t-I scl:sda\tDecode I2C\n"
+        "\t-C\t\tReport decoded frames as CSV\n"
+        "\t-s\t\tReport per gpio statistics (table)\n"
+        "\t-j\t\tReport per gpio statistics as JSON\n"
+        "\t-N segs\t\tSplit the blocks into segs triggered captures\n"
+        "\t\t\t(not with -U, -S, -I, -s, -j, -P or -W)\n"
+        "\t-P\t\tWrite zoom summaries to captured.sum\n"
+        "\t-W\t\tWrite the raw capture to captured.raw (see capcmp)\n"
         "\t-R gpio\t\tTrigger on rising edge\n"
         "\t-F gpio\t\tTrigger on falling edge\n"
         "\t-H gpio\t\tTrigger on level High\n"
@@ -61,39 +95,120 @@ usage(const char *cmd) {
 	"\t  high and low may be combined.\n"
 	"\t* To run command with all defaults (no options), specify '--' in\n"
 	"\t  place of any options.\n"
+	"\t* Without -r, samples are taken as fast as DMA allows (~80.5ns),\n"
+	"\t  which varies with bus load.\n"
+	"\t* With -t, DMA stalls appear as gaps in the timeline (1 usec\n"
+	"\t  timer resolution), at a lower sample rate.\n"
 	"\t* If gtkwave fails to launch, examine file .gtkwave.out in the\n"
 	"\t  current directory.\n",
         cmd,
         PAGES*4);
 }
 
+//////////////////////////////////////////////////////////////////////
+// Look for the trigger in dblock[], returning its sample # via *at
+//////////////////////////////////////////////////////////////////////
+
 static bool
-got_trigger(int trigger_gpio,int triggers,uint32_t *dblock,size_t samps) {
+got_trigger(int trigger_gpio,int triggers,uint32_t *dblock,size_t samps,unsigned *at,unsigned stride=1) {
     uint32_t mask = 1 << trigger_gpio;
     uint32_t bits_a, bits_b;
     
     for ( unsigned ux = 0; ux < samps; ++ux ) {
-        bits_a = dblock[ux];
+        bool hit = false;
+
+        bits_a = dblock[ux*stride];
         if ( triggers & TRIG_H && bits_a & mask )
-            return true;    // Triggered on High
+            hit = true;     // Triggered on High
         if ( triggers & TRIG_L && !(bits_a & mask) )
-            return true;    // Triggered on Low
-        if ( ux == 0 )
-            continue;
-
-        bits_b = dblock[ux-1];
-        if ( triggers & TRIG_R && !(bits_b & mask) && (bits_a & mask) )
-            return true;    // Triggered on rising edge
-        if ( triggers & TRIG_F && (bits_b & mask) && !(bits_a & mask) )
-            return true;    // Triggered on falling edge
+            hit = true;     // Triggered on Low
+
+        if ( !hit && ux > 0 ) {
+            bits_b = dblock[(ux-1)*stride];
+            if ( triggers & TRIG_R && !(bits_b & mask) && (bits_a & mask) )
+                hit = true; // Triggered on rising edge
+            if ( triggers & TRIG_F && (bits_b & mask) && !(bits_a & mask) )
+                hit = true; // Triggered on falling edge
+        }
+
+        if ( hit ) {
+            *at = ux;
+            return true;
+        }
     }
 
     return false;           // No trigger found
 }
 
+static bool
+valid_gpio(int gpio) {
+    return gpio >= 0 && gpio <= 31;
+}
+
+static bool
+optional_gpio(int gpio) {
+    return gpio < 0 || valid_gpio(gpio);   // < 0 when unused
+}
+
+//////////////////////////////////////////////////////////////////////
+// Decode protocols requested by -U, -S and -I, to stdout
+//////////////////////////////////////////////////////////////////////
+
+static void
+decode(LogicAnalyzer& logana,double period_ns) {
+    std::vector<ProtoDecoder::s_frame> frames;
+    EdgeIndex idx;
+
+    logana.index(idx);
+
+    if ( opt_uart ) {
+        int rx = -1;
+        double baud = 0.0, bit_samples;
+
+        if ( sscanf(opt_uart,"%d:%lf",&rx,&baud) < 1 || !valid_gpio(rx) ) {
+            fprintf(stderr,"Invalid -U %s\n",opt_uart);
+            exit(2);
+        }
+        if ( baud > 0.0 )
+            bit_samples = 1e9 / baud / period_ns;
+        else if ( (bit_samples = ProtoDecoder::uart_autobaud(idx,rx)) > 0.0 )
+            printf("UART gpio%d: %.0f baud (auto)\n",rx,1e9 / ( bit_samples * period_ns ));
+        ProtoDecoder::uart(idx,rx,bit_samples,frames);
+    }
+
+    if ( opt_spi ) {
+        int cs = -1, sck = -1, mosi = -1, miso = -1, mode = 0;
+
+        if ( sscanf(opt_spi,"%d:%d:%d:%d:%d",&cs,&sck,&mosi,&miso,&mode) < 4
+          || !valid_gpio(sck) || !optional_gpio(cs) || !optional_gpio(mosi)
+          || !optional_gpio(miso) || mode < 0 || mode > 3 ) {
+            fprintf(stderr,"Invalid -S %s\n",opt_spi);
+            exit(2);
+        }
+        ProtoDecoder::spi(idx,cs,sck,mosi,miso,mode,frames);
+    }
+
+    if ( opt_i2c ) {
+        int scl = -1, sda = -1;
+
+        if ( sscanf(opt_i2c,"%d:%d",&scl,&sda) != 2 || !valid_gpio(scl) || !valid_gpio(sda) ) {
+            fprintf(stderr,"Invalid -I %s\n",opt_i2c);
+            exit(2);
+        }
+        ProtoDecoder::i2c(idx,scl,sda,frames);
+    }
+
+    // Report in time order when several protocols are decoded
+    std::stable_sort(frames.begin(),frames.end(),
+        [](const ProtoDecoder::s_frame& a,const ProtoDecoder::s_frame& b) {
+            return a.start < b.start;
+        });
+    ProtoDecoder::write(stdout,frames,period_ns,opt_csv);
+}
+
 int
 main(int argc,char **argv) {
-    static const char options[] = "b:R:F:H:L:T:xzvh";
+    static const char options[] = "b:r:tU:S:I:CsjN:PWR:F:H:L:T:xzvh";
     bool opt_errs = false, opt_x = false, opt_z = false;
     LogicAnalyzer logana(PAGES);
     int optch, trigger = 0, trigger_gpio = -1;
@@ -115,6 +230,43 @@ main(int argc,char **argv) {
         case 'b':
             opt_blocks = atoi(optarg);
             break;
+        case 'r':
+            opt_rate = atof(optarg);
+            if ( opt_rate <= 0.0 ) {
+                fprintf(stderr,"Invalid rate: -r %s\n",optarg);
+                exit(2);
+            }
+            break;
+        case 't':
+            opt_stamps = true;
+            break;
+        case 'U':
+            opt_uart = optarg;
+            break;
+        case 'S':
+            opt_spi = optarg;
+            break;
+        case 'I':
+            opt_i2c = optarg;
+            break;
+        case 'C':
+            opt_csv = true;
+            break;
+        case 's':
+            opt_stats = true;
+            break;
+        case 'j':
+            opt_json = true;
+            break;
+        case 'N':
+            opt_N = atoi(optarg);
+            break;
+        case 'P':
+            opt_P = true;
+            break;
+        case 'W':
+            opt_W = true;
+            break;
         case 'R':
             trigger |= TRIG_R;
             if ( !optarg || optarg[0] == '-' ) {
@@ -193,6 +345,28 @@ main(int argc,char **argv) {
         ++opt_errs;
     }
 
+    if ( opt_stamps && ( opt_uart || opt_spi || opt_i2c || opt_stats || opt_json || opt_P || opt_W ) ) {
+        fprintf(stderr,"Decoding (-U, -S or -I), statistics (-s, -j), summaries (-P) and raw files (-W)\n"
+            "are not supported with -t\n");
+        ++opt_errs;
+    }
+
+    if ( opt_N < 1 || opt_N > opt_blocks ) {
+        fprintf(stderr,"Segments (-N) must be from 1 to the number of blocks (%d)\n",
+            opt_blocks);
+        ++opt_errs;
+    } else if ( opt_N > 1 && ( opt_rate > 0.0 || opt_stamps ) ) {
+        fprintf(stderr,"Segments (-N) are not supported with -r or -t\n");
+        ++opt_errs;
+    } else if ( opt_N > 1 && ( opt_uart || opt_spi || opt_i2c || opt_stats || opt_json || opt_P || opt_W ) ) {
+        // Segments are joined end to end: each boundary would decode
+        // as edges, frames and run breaks that never happened, and a
+        // raw file would carry only the first segment's trigger
+        fprintf(stderr,"Decoding (-U, -S or -I), statistics (-s, -j), summaries (-P) and raw files (-W)\n"
+            "are not supported with -N\n");
+        ++opt_errs;
+    }
+
     if ( opt_errs ) {
         usage(argv[0]);
         exit(1);
@@ -200,6 +374,8 @@ main(int argc,char **argv) {
 
     unlink(".gtkwave.out");
 
+    opt_blocks = opt_blocks / opt_N * opt_N; // Whole segments only
+
     if ( !logana.open() ) {
         fprintf(stderr,"%s\n",logana.error());
         fprintf(stderr,"Make sure that the rpidma.ko module is loaded.\n");
@@ -208,7 +384,8 @@ main(int argc,char **argv) {
 
     if ( !logana.alloc_blocks(opt_blocks) ) {
         fprintf(stderr,
-		"Unable to allocate %d x %dk blocks\n",
+		"%s: Unable to allocate %d x %dk blocks\n",
+		logana.error(),
 		opt_blocks,
 		PAGES * 4);
         exit(2);
@@ -224,62 +401,105 @@ main(int argc,char **argv) {
     //////////////////////////////////////////////////////////////////
 
     static const uint32_t GPIO_GPLEV0 = 0x7E200034;
-    int tries = 0, safety;
+    const unsigned seg_blocks = unsigned(opt_blocks) / opt_N;
+    std::vector<s_segment> segments(opt_N);
+    int tries, safety;
+
+    logana.set_rate(opt_rate);
+    logana.set_timestamps(opt_stamps);
+
+    if ( opt_verbose && opt_N > 1 )
+        printf("%d segments of %u blocks.\n",opt_N,seg_blocks);
+
+    for ( int seg = 0; seg < opt_N; ++seg ) {
+        s_segment& segment = segments[seg];
+
+        // Set up the transfer once per segment, for quick re-arming:
+        if ( opt_N > 1 )
+            logana.set_segment(seg * seg_blocks,seg_blocks);
 
-    while ( ++tries < opt_T ) {
-        // Start capture
-        if ( !logana.start(GPIO_GPLEV0) ) {
-            fprintf(stderr,"Unable to start DMA.\n");
+        if ( !logana.prepare(GPIO_GPLEV0) ) {
+            fprintf(stderr,"%s: Unable to prepare DMA.\n",logana.error());
             logana.close();
             exit(5);
         }
 
-        if ( !trigger ) {
-            if ( opt_verbose )
-                puts("No triggers..");
-            break;
-        }
+        if ( opt_verbose && opt_rate > 0.0 )
+            printf("Paced sampling at %.3f Hz.\n",logana.get_rate());
+
+        segment.trigger = 0;
+        tries = 0;
+
+        while ( ++tries < opt_T ) {
+            // Start capture
+            if ( !logana.restart() ) {
+                fprintf(stderr,"%s: Unable to start DMA.\n",logana.error());
+                logana.close();
+                exit(5);
+            }
+
+            if ( !trigger ) {
+                if ( opt_verbose && seg == 0 )
+                    puts("No triggers..");
+                break;
+            }
 
-        // See if we can spot the trigger, by waiting
-        // to capture one block:
-	while ( !logana.read_1stblock() )
-        	usleep(10);
+            // See if we can spot the trigger, by waiting
+            // to capture one block:
+            while ( !logana.read_1stblock() )
+                usleep(10);
             
-        size_t samps;
-        uint32_t *dblock = logana.get_samples(0,&samps);
+            size_t samps;
+            uint32_t *dblock = logana.get_samples(seg * seg_blocks,&samps);
 
-        assert(samps > 0);
+            assert(samps > 0);
 
-        if ( opt_verbose && tries == 1 )
-            puts("Sampling for trigger(s)");
+            if ( opt_verbose && tries == 1 )
+                puts("Sampling for trigger(s)");
 
-        if ( got_trigger(trigger_gpio,trigger,dblock,samps) ) {
-            if ( opt_verbose )
-                puts("Got trigger.");
-            break;
-	}
+            bool triggered = opt_stamps
+                ? got_trigger(trigger_gpio,trigger,dblock+1,samps/2,&segment.trigger,2)
+                : got_trigger(trigger_gpio,trigger,dblock,samps,&segment.trigger);
 
-	// Abort and retry with next loop..
-	logana.cancel();
-    }
+            if ( triggered ) {
+                if ( opt_verbose )
+                    printf("Got trigger (segment %d).\n",seg);
+                break;
+            }
 
-    if ( tries >= opt_T ) {
-        fprintf(stderr,"No trigger after %d tries.\n",tries);
-        logana.close();
-        exit(6);
-    }
+            // Abort and retry with next loop..
+            logana.cancel();
+        }
 
-    // Wait for DMA completion
-    safety = 500000;
+        clock_gettime(CLOCK_REALTIME,&segment.when);
+        segment.tries = tries;
 
-    while ( --safety > 0 && logana.is_completed() != 1 ) {
-        usleep(10);
-    }
+        if ( tries >= opt_T ) {
+            fprintf(stderr,"No trigger after %d tries.\n",tries);
+            logana.close();
+            exit(6);
+        }
+
+        // Wait for DMA completion
+        safety = 500000;
+
+        if ( opt_rate > 0.0 ) {
+            // Allow twice the paced capture time (in 10us polls)
+            double us = logana.get_blocks() * PAGES * 1024 * 1e6 / logana.get_rate();
+
+            if ( us / 5.0 > safety )
+                safety = int(us / 5.0);
+        }
+
+        while ( --safety > 0 && logana.is_completed() != 1 ) {
+            usleep(10);
+        }
     
-    if ( safety <= 0 ) {
-        fprintf(stderr,"Timed out: Waiting for DMA transfer.\n");
-        logana.close();
-        exit(13);
+        if ( safety <= 0 ) {
+            fprintf(stderr,"Timed out: Waiting for DMA transfer.\n");
+            logana.close();
+            exit(13);
+        }
     }
 
     VCD_Out vcdout;
@@ -288,13 +508,110 @@ main(int argc,char **argv) {
     printf("Captured: writing capture.vcd\n");
 
     // Create VCD file:
-    if ( !vcdout.open("captured.vcd",80.5,"ns","vcdout.cpp") ) {
+    double timescale = logana.sample_period(); // ns per sample
+    const char *timebase = opt_rate > 0.0 ? "paced" : "measured";
+    std::vector<double> t_ns;       // Per sample times (-t)
+
+    if ( opt_stamps ) {
+        if ( !logana.sample_times(t_ns) ) {
+            fprintf(stderr,"%s\n",logana.error());
+            exit(14);
+        }
+        timebase = "timestamped";
+    }
+
+    if ( opt_verbose && opt_rate <= 0.0 && !opt_stamps ) {
+        s_rpidma_stats dstats;
+
+        if ( logana.driver_stats(dstats) )
+            printf("Driver: %u submits, %u completions, %u errors, first byte max %u us\n",
+                dstats.submits,dstats.completions,dstats.errors,dstats.first_max_us);
+    }
+
+    if ( timescale <= 0.0 ) {
+        fprintf(stderr,"%s: Sample period unknown, assuming 80.5 ns.\n",
+            logana.error());
+        timescale = 80.5;           // Typical free running DMA
+        timebase = "assumed";
+    }
+
+    printf("Sample period: %.3f ns (%s), %.3f MHz\n",
+        timescale,timebase,1e3 / timescale);
+
+    if ( opt_uart || opt_spi || opt_i2c )
+        decode(logana,timescale);
+
+    if ( opt_stats || opt_json ) {
+        SignalStats stats;
+
+        logana.statistics(stats);
+        if ( opt_stats )
+            stats.write_table(stdout,timescale);
+        if ( opt_json )
+            stats.write_json(stdout,timescale);
+    }
+
+    if ( opt_P ) {
+        SummaryPyramid pyr;
+        int er;
+
+        logana.summarize(pyr);
+        if ( (er = pyr.save("captured.sum")) != 0 )
+            fprintf(stderr,"%s: writing captured.sum\n",strerror(er));
+        else if ( opt_verbose )
+            printf("Wrote captured.sum: %u levels, %llu samples\n",
+                pyr.get_levels(),(unsigned long long)pyr.get_samples());
+    }
+
+    if ( opt_W ) {
+        uint64_t trig = trigger ? uint64_t(segments[0].trigger) : RAWCAP_NO_TRIGGER;
+
+        if ( !logana.save_raw("captured.raw",trig) )
+            fprintf(stderr,"%s\n",logana.error());
+        else if ( opt_verbose )
+            puts("Wrote captured.raw");
+    }
+
+    if ( !vcdout.open("captured.vcd",opt_stamps ? 1.0 : timescale,"ns","vcdout.cpp") ) {
         fprintf(stderr,"%s: writing %s\n",
             strerror(errno),
             vcdout.get_pathname());
         exit(14);
     }
 
+    {
+        char meta[128];
+
+        snprintf(meta,sizeof meta,"pispy sample_period_ns=%.3f timebase=%s samples=%u",
+            timescale,timebase,unsigned(opt_blocks)*PAGES*1024/(opt_stamps ? 2 : 1));
+        vcdout.comment(meta);
+    }
+
+    // Trigger sample # of each segment, within the whole capture
+    std::vector<uint64_t> marks;
+    const uint64_t seg_samps = uint64_t(seg_blocks) * PAGES * 1024;
+
+    if ( opt_N > 1 ) {
+        for ( int seg = 0; seg < opt_N; ++seg ) {
+            const s_segment& segment = segments[seg];
+            char meta[160], tbuf[64];
+            struct tm tc;
+
+            localtime_r(&segment.when.tv_sec,&tc);
+            strftime(tbuf,sizeof tbuf,"%Y-%m-%d %H:%M:%S",&tc);
+
+            marks.push_back(seg * seg_samps + segment.trigger);
+            snprintf(meta,sizeof meta,"pispy segment=%d first_sample=%llu trigger_sample=%llu time=%s.%06ld tries=%d",
+                seg,
+                (unsigned long long)(seg * seg_samps),
+                (unsigned long long)marks.back(),
+                tbuf,
+                long(segment.when.tv_nsec / 1000),
+                segment.tries);
+            vcdout.comment(meta);
+        }
+    }
+
     // Define GPIO signals:
     for ( int x=0; x<32; ++x ) {
         char name[32];
@@ -303,19 +620,57 @@ main(int argc,char **argv) {
         vcdout.define_binary(x,name);
     }
 
+    if ( opt_N > 1 )
+        vcdout.define_binary(32,"trigger"); // Pulses at each segment's trigger
+
     // Write out capture data:
     unsigned t;
     vcdout.set_time(t=0);
 
-    for ( unsigned ux=0; ux < unsigned(opt_blocks); ++ux ) {
-        uint32_t *dblock = logana.get_samples(ux,&samps);
+    if ( opt_stamps ) {
+        // Use the true (timestamped) sample times
+        s_logana_stamp *stamps = logana.get_stamps(&samps);
 
         for ( unsigned uy=0; uy < samps; ++uy ) {
-            uint32_t yblock = dblock[uy];
+            vcdout.set_time(unsigned(t_ns[uy] + 0.5));
+            for ( unsigned uz=0; uz < 32; ++uz )
+                vcdout.set_value(uz,!!(stamps[uy].levels & (1<<uz)));
+        }
+    } else  {
+        // Only the runs (changes) need to be visited
+        RLECapture rle;
+
+        logana.encode(rle);
+        if ( opt_verbose )
+            printf("%lu samples encoded as %lu runs (%lu bytes)\n",
+                (unsigned long)rle.get_samples(),
+                (unsigned long)rle.get_runs(),
+                (unsigned long)rle.get_bytes());
+
+        // Trigger marker changes, merged in time order with the runs
+        std::vector<std::pair<uint64_t,bool> > events;
+        size_t ex = 0;
+
+        for ( uint64_t mark : marks ) {
+            events.push_back(std::make_pair(mark,true));
+            events.push_back(std::make_pair(mark+1,false));
+        }
+        if ( opt_N > 1 )
+            vcdout.set_value(32,false);
 
+        for ( auto run : rle ) {
+            for ( ; ex < events.size() && events[ex].first <= run.index(); ++ex ) {
+                vcdout.set_time(unsigned(events[ex].first));
+                vcdout.set_value(32,events[ex].second);
+            }
+            vcdout.set_time(t = unsigned(run.index()));
             for ( unsigned uz=0; uz < 32; ++uz )
-                vcdout.set_value(uz,!!(yblock & (1<<uz)));
-            vcdout.set_time(++t);
+                vcdout.set_value(uz,!!(run.value() & (1<<uz)));
+        }
+
+        for ( ; ex < events.size(); ++ex ) {
+            vcdout.set_time(unsigned(events[ex].first));
+            vcdout.set_value(32,events[ex].second);
         }
     }
 